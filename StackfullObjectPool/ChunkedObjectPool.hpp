@@ -0,0 +1,441 @@
+﻿#ifndef CHUNKED_OBJECT_POOL
+#define CHUNKED_OBJECT_POOL
+
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "StackfullObjectPool.hpp"
+
+
+namespace sop
+{
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits = DefaultPoolTraits>
+    class ChunkedObjectPool;
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits = DefaultPoolTraits>
+    class ChunkedPoolItemDeleter
+    {
+    public:
+        ChunkedPoolItemDeleter(ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>& objectPool)
+            : objectPool_{ &objectPool }
+        { }
+
+        void operator()(T* obj) const
+        {
+            // NOTE: The pool's lifetime must exceed that of its objects,
+            // otherwise it'll lead to undefined behavior
+
+            objectPool_->release(obj);
+        }
+
+    private:
+        ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>* objectPool_;
+    };
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits = DefaultPoolTraits>
+    using ChunkedPoolItem = std::unique_ptr<T, const ChunkedPoolItemDeleter<T, CHUNK_CAPACITY, Traits>&>;
+
+
+    // An elastic pool which adds chunks of CHUNK_CAPACITY slots, up to maxChunks of them, as the chunks it has run full,
+    // so max_capacity_exception is only thrown once all maxChunks chunks are full. Chunks are never moved or freed
+    // while the pool lives, so objects keep their addresses.
+    // Every chunk is aligned to its own size rounded up to a power of two and starts with a header holding its free list
+    // and a count of its live objects, so release() finds the owning chunk by masking the object's address.
+    // Where mmap is available every chunk is a mapping of its own, and trim() hands the memory of chunks with
+    // no live objects back to the OS and takes them out of service until the pool grows again;
+    // a non-zero trimInterval runs it on a background thread that often.
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    class ChunkedObjectPool
+    {
+    public:
+        using FreeList = typename Traits::template FreeList<CHUNK_CAPACITY>;
+        using Layout = SlotLayout<T, Traits>;
+
+        static_assert(FITS_FREE_LIST<FreeList, Layout::SIZE>, "T is too small to hold the free list's links, pick another FreeList.");
+
+        explicit ChunkedObjectPool(std::size_t maxChunks, std::chrono::milliseconds trimInterval = std::chrono::milliseconds::zero()) noexcept(false);
+
+        ~ChunkedObjectPool();
+
+        template <typename... Args>
+        [[nodiscard]] ChunkedPoolItem<T, CHUNK_CAPACITY, Traits> request(Args&&... args) noexcept(false);
+
+        // as request(), but a pool exhausted at maxChunks returns an empty optional rather than going through Traits::ErrorPolicy
+        template <typename... Args>
+        [[nodiscard]] std::optional<ChunkedPoolItem<T, CHUNK_CAPACITY, Traits>> tryRequest(Args&&... args) noexcept(false);
+
+        // returns the number of chunks trimmed
+        std::size_t trim() noexcept;
+
+        // the slots of the chunks in service
+        [[nodiscard]] std::size_t capacity() const noexcept;
+
+        [[nodiscard]] std::size_t maxCapacity() const noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        [[nodiscard]] bool isFull() const noexcept;
+
+    private:
+        friend class ChunkedPoolItemDeleter<T, CHUNK_CAPACITY, Traits>;
+
+        struct alignas(CACHE_LINE_SIZE) ChunkHeader
+        {
+            explicit ChunkHeader(std::size_t chunkIndex) noexcept
+                : freeList{ makeFreeList<FreeList, Layout::SIZE>(slots()) }
+                , index{ chunkIndex }
+                , trimmed{ false }
+                , live{ 0U }
+            { }
+
+            [[nodiscard]] std::byte* slots() noexcept
+            {
+                return reinterpret_cast<std::byte*>(this) + SLOTS_OFFSET;
+            }
+
+            FreeList freeList;
+            const std::size_t index;
+            // guarded by growthMutex_
+            bool trimmed;
+            // bumped after a slot is acquired and dropped after it's released, so it never undercounts the slots in use
+            alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> live;
+        };
+
+        static constexpr std::size_t SLOTS_OFFSET{ (sizeof(ChunkHeader) + Layout::ALIGNMENT - 1U) / Layout::ALIGNMENT * Layout::ALIGNMENT };
+        static constexpr std::size_t CHUNK_SIZE{ SLOTS_OFFSET + CHUNK_CAPACITY * Layout::SIZE };
+        static constexpr std::size_t CHUNK_ALIGNMENT{ std::bit_ceil(CHUNK_SIZE) };
+
+        const std::size_t maxChunks_;
+        // chunks_[0, chunkCount_) are set once, before chunkCount_ is bumped past them
+        const std::unique_ptr<ChunkHeader*[]> chunks_;
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> chunkCount_;
+        // a chunk which had an open slot lately, where requests start looking
+        std::atomic<std::size_t> hint_;
+        std::atomic<std::size_t> trimmedCount_;
+        alignas(CACHE_LINE_SIZE) std::mutex growthMutex_;
+        // guarded by growthMutex_
+        std::vector<std::size_t> trimmed_;
+        const std::unique_ptr<std::size_t[]> scratch_;
+        const ChunkedPoolItemDeleter<T, CHUNK_CAPACITY, Traits> poolItemDeleter_;
+        std::mutex trimmerMutex_;
+        std::condition_variable_any trimmerWakeup_;
+        std::jthread trimmer_;
+
+        // returns false once there's no chunk left to add
+        [[nodiscard]] bool grow(std::size_t seenChunkCount) noexcept(false);
+
+        // maps a chunk of its own where mmap is available, so trim() may decommit its pages
+        [[nodiscard]] static ChunkHeader* allocateChunk(std::size_t chunkIndex) noexcept(false);
+
+        static void freeChunk(ChunkHeader* chunk) noexcept;
+
+        // nullptr once the pool is exhausted at maxChunks
+        template <typename... Args>
+        [[nodiscard]] T* tryConstruct(Args&&... args) noexcept(false);
+
+        void release(T* obj) noexcept;
+    };
+
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::ChunkedObjectPool(std::size_t maxChunks, std::chrono::milliseconds trimInterval) noexcept(false)
+        : maxChunks_{ maxChunks }
+        , chunks_{ std::make_unique<ChunkHeader*[]>(maxChunks) }
+        , chunkCount_{ 0U }
+        , hint_{ 0U }
+        , trimmedCount_{ 0U }
+        , growthMutex_{}
+        , trimmed_{}
+        , scratch_{ std::make_unique<std::size_t[]>(CHUNK_CAPACITY) }
+        , poolItemDeleter_{ *this }
+        , trimmerMutex_{}
+        , trimmerWakeup_{}
+        , trimmer_{}
+    {
+        trimmed_.reserve(maxChunks);
+
+        if (trimInterval != std::chrono::milliseconds::zero())
+        {
+            trimmer_ = std::jthread{ [this, trimInterval](std::stop_token stop)
+                {
+                    std::unique_lock lock{ trimmerMutex_ };
+
+                    while (!trimmerWakeup_.wait_for(lock, stop, trimInterval, [&stop] { return stop.stop_requested(); }))
+                    {
+                        trim();
+                    }
+                } };
+        }
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::~ChunkedObjectPool()
+    {
+        // the trimmer must be done with the chunks before they're freed
+        if (trimmer_.joinable())
+        {
+            trimmer_.request_stop();
+            trimmer_.join();
+        }
+
+        const std::size_t chunkCount{ chunkCount_.load(std::memory_order_acquire) };
+
+        for (std::size_t i{ 0U }; i != chunkCount; ++i)
+        {
+            freeChunk(chunks_[i]);
+        }
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    template <typename... Args>
+    ChunkedPoolItem<T, CHUNK_CAPACITY, Traits> ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::request(Args&&... args) noexcept(false)
+    {
+        T* const obj{ tryConstruct(std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
+        }
+
+        return { obj, poolItemDeleter_ };
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    template <typename... Args>
+    std::optional<ChunkedPoolItem<T, CHUNK_CAPACITY, Traits>> ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::tryRequest(Args&&... args) noexcept(false)
+    {
+        T* const obj{ tryConstruct(std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
+        {
+            return std::nullopt;
+        }
+
+        return std::optional<ChunkedPoolItem<T, CHUNK_CAPACITY, Traits>>{ std::in_place, obj, poolItemDeleter_ };
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    template <typename... Args>
+    T* ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::tryConstruct(Args&&... args) noexcept(false)
+    {
+        for (;;)
+        {
+            const std::size_t chunkCount{ chunkCount_.load(std::memory_order_acquire) };
+            const std::size_t hint{ hint_.load(std::memory_order_relaxed) };
+
+            for (std::size_t i{ 0U }; i != chunkCount; ++i)
+            {
+                const std::size_t chunkIdx{ (hint + i) % chunkCount };
+                ChunkHeader* const chunk{ chunks_[chunkIdx] };
+                std::size_t idx;
+
+                if (chunk->freeList.acquire(idx)) [[likely]]
+                {
+                    chunk->live.fetch_add(1U, std::memory_order_relaxed);
+
+                    if (chunkIdx != hint)
+                    {
+                        hint_.store(chunkIdx, std::memory_order_relaxed);
+                    }
+
+                    return constructAt<T>(chunk->slots() + idx * Layout::SIZE, std::forward<Args>(args)...);
+                }
+            }
+
+            if (!grow(chunkCount)) [[unlikely]]
+            {
+                return nullptr;
+            }
+        }
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    bool ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::grow(std::size_t seenChunkCount) noexcept(false)
+    {
+        std::lock_guard lock{ growthMutex_ };
+
+        // another thread added a chunk in the meantime
+        if (chunkCount_.load(std::memory_order_relaxed) != seenChunkCount)
+        {
+            return true;
+        }
+
+        // a trimmed chunk is put back in service before a new one is added
+        if (!trimmed_.empty())
+        {
+            ChunkHeader* const chunk{ chunks_[trimmed_.back()] };
+            trimmed_.pop_back();
+
+            // uncounted before its slots are released, so a concurrent size() never underflows
+            trimmedCount_.fetch_sub(1U, std::memory_order_relaxed);
+            std::iota(scratch_.get(), scratch_.get() + CHUNK_CAPACITY, std::size_t{ 0U });
+            releaseBulk(chunk->freeList, std::span<const std::size_t>{ scratch_.get(), CHUNK_CAPACITY });
+            chunk->trimmed = false;
+            hint_.store(chunk->index, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        if (seenChunkCount == maxChunks_)
+        {
+            return false;
+        }
+
+        chunks_[seenChunkCount] = allocateChunk(seenChunkCount);
+        hint_.store(seenChunkCount, std::memory_order_relaxed);
+        chunkCount_.store(seenChunkCount + 1U, std::memory_order_release);
+
+        return true;
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    auto ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::allocateChunk(std::size_t chunkIndex) noexcept(false) -> ChunkHeader*
+    {
+#ifdef SOP_HAS_MMAP
+        static const std::size_t pageSize{ static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)) };
+
+        // mmap only aligns to a page, so map an extra CHUNK_ALIGNMENT and unmap what's left over on either side
+        const std::size_t chunkSize{ (CHUNK_SIZE + pageSize - 1U) / pageSize * pageSize };
+        const std::size_t slack{ std::max(CHUNK_ALIGNMENT, pageSize) };
+        void* const region{ ::mmap(nullptr, chunkSize + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+
+        if (region == MAP_FAILED) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<std::bad_alloc>();
+        }
+
+        std::byte* const begin{ static_cast<std::byte*>(region) };
+        std::byte* const chunk{ begin + ((CHUNK_ALIGNMENT - reinterpret_cast<std::uintptr_t>(begin) % CHUNK_ALIGNMENT) % CHUNK_ALIGNMENT) };
+
+        if (chunk != begin)
+        {
+            ::munmap(begin, static_cast<std::size_t>(chunk - begin));
+        }
+
+        if (std::byte* const end{ begin + chunkSize + slack }; chunk + chunkSize != end)
+        {
+            ::munmap(chunk + chunkSize, static_cast<std::size_t>(end - (chunk + chunkSize)));
+        }
+
+        return new (chunk) ChunkHeader{ chunkIndex };
+#else
+        return new (::operator new(CHUNK_SIZE, std::align_val_t{ CHUNK_ALIGNMENT })) ChunkHeader{ chunkIndex };
+#endif
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    void ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::freeChunk(ChunkHeader* chunk) noexcept
+    {
+        chunk->~ChunkHeader();
+
+#ifdef SOP_HAS_MMAP
+        static const std::size_t pageSize{ static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)) };
+
+        ::munmap(chunk, (CHUNK_SIZE + pageSize - 1U) / pageSize * pageSize);
+#else
+        ::operator delete(chunk, std::align_val_t{ CHUNK_ALIGNMENT });
+#endif
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    void ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::release(T* obj) noexcept
+    {
+        ChunkHeader* const chunk{ reinterpret_cast<ChunkHeader*>(reinterpret_cast<std::uintptr_t>(obj) & ~(CHUNK_ALIGNMENT - 1U)) };
+        const std::size_t freedObjIdx{ static_cast<std::size_t>(reinterpret_cast<std::byte*>(obj) - chunk->slots()) / Layout::SIZE };
+
+        chunk->freeList.release(freedObjIdx);
+
+        // the chunk was full, point requests at it
+        if (chunk->live.fetch_sub(1U, std::memory_order_relaxed) == CHUNK_CAPACITY) [[unlikely]]
+        {
+            hint_.store(chunk->index, std::memory_order_relaxed);
+        }
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    std::size_t ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::trim() noexcept
+    {
+        std::lock_guard lock{ growthMutex_ };
+
+        const std::size_t chunkCount{ chunkCount_.load(std::memory_order_relaxed) };
+        const std::span<std::size_t> indices{ scratch_.get(), CHUNK_CAPACITY };
+        std::size_t trimmedNow{ 0U };
+
+        for (std::size_t i{ 0U }; i != chunkCount; ++i)
+        {
+            ChunkHeader* const chunk{ chunks_[i] };
+
+            if (chunk->trimmed || chunk->live.load(std::memory_order_relaxed) != 0U)
+            {
+                continue;
+            }
+
+            // holding every slot of the chunk keeps requests off it
+            const std::size_t acquired{ acquireBulk(chunk->freeList, indices) };
+
+            if (acquired != CHUNK_CAPACITY)
+            {
+                releaseBulk(chunk->freeList, std::span<const std::size_t>{ indices.first(acquired) });
+                continue;
+            }
+
+            decommit(chunk->slots(), chunk->slots() + CHUNK_CAPACITY * Layout::SIZE);
+            chunk->trimmed = true;
+            trimmed_.push_back(i);
+            trimmedCount_.fetch_add(1U, std::memory_order_relaxed);
+            ++trimmedNow;
+        }
+
+        return trimmedNow;
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    std::size_t ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::capacity() const noexcept
+    {
+        return (chunkCount_.load(std::memory_order_acquire) - trimmedCount_.load(std::memory_order_relaxed)) * CHUNK_CAPACITY;
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    std::size_t ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::maxCapacity() const noexcept
+    {
+        return maxChunks_ * CHUNK_CAPACITY;
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    std::size_t ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::size() const noexcept
+    {
+        const std::size_t chunkCount{ chunkCount_.load(std::memory_order_acquire) };
+        std::size_t size{ 0U };
+
+        for (std::size_t i{ 0U }; i != chunkCount; ++i)
+        {
+            size += chunks_[i]->live.load(std::memory_order_relaxed);
+        }
+
+        return size;
+    }
+
+    template <PoolItemConcept T, std::size_t CHUNK_CAPACITY, typename Traits>
+    bool ChunkedObjectPool<T, CHUNK_CAPACITY, Traits>::isFull() const noexcept
+    {
+        return size() == maxCapacity();
+    }
+}
+
+
+#endif // !CHUNKED_OBJECT_POOL
@@ -0,0 +1,186 @@
+﻿#ifndef DYNAMIC_OBJECT_POOL
+#define DYNAMIC_OBJECT_POOL
+
+
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+#include "StackfullObjectPool.hpp"
+
+
+namespace sop
+{
+    template <PoolItemConcept T, typename Traits = DefaultPoolTraits>
+    class DynamicObjectPool;
+
+    template <PoolItemConcept T, typename Traits = DefaultPoolTraits>
+    class DynamicPoolItemDeleter
+    {
+    public:
+        DynamicPoolItemDeleter(DynamicObjectPool<T, Traits>& objectPool)
+            : objectPool_{ &objectPool }
+        { }
+
+        void operator()(T* obj) const
+        {
+            // NOTE: The pool's lifetime must exceed that of its objects,
+            // otherwise it'll lead to undefined behavior
+
+            objectPool_->release(obj);
+        }
+
+    private:
+        DynamicObjectPool<T, Traits>* objectPool_;
+    };
+
+    template <PoolItemConcept T, typename Traits = DefaultPoolTraits>
+    using DynamicPoolItem = std::unique_ptr<T, const DynamicPoolItemDeleter<T, Traits>&>;
+
+
+    // StackfullObjectPool's sibling whose capacity is given to its constructor rather than as a template parameter,
+    // so it may be sized at startup, and pools of any capacity share a single instantiation per T and Traits.
+    // The slots are always allocated on the heap (Traits::Storage is ignored), and Traits::FreeList<DYNAMIC_CAPACITY>
+    // must accept a run time capacity - LockedStack (the default) and TreiberStack do, as do caches wrapping them.
+    template <PoolItemConcept T, typename Traits>
+    class DynamicObjectPool
+    {
+    public:
+        using FreeList = typename Traits::template FreeList<DYNAMIC_CAPACITY>;
+        using Layout = SlotLayout<T, Traits>;
+
+        static_assert(FITS_FREE_LIST<FreeList, Layout::SIZE>, "T is too small to hold the free list's links, pick another FreeList.");
+
+        explicit DynamicObjectPool(std::size_t capacity) noexcept(false);
+
+        template <typename... Args>
+        [[nodiscard]] DynamicPoolItem<T, Traits> request(Args&&... args) noexcept(false);
+
+        // as request(), but an exhausted pool returns an empty optional rather than going through Traits::ErrorPolicy
+        template <typename... Args>
+        [[nodiscard]] std::optional<DynamicPoolItem<T, Traits>> tryRequest(Args&&... args) noexcept(false);
+
+        [[nodiscard]] std::size_t capacity() const noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        [[nodiscard]] bool isFull() const noexcept;
+
+    private:
+        friend class DynamicPoolItemDeleter<T, Traits>;
+
+        struct SlotsDeleter
+        {
+            void operator()(std::byte* slots) const noexcept
+            {
+                ::operator delete(slots, std::align_val_t{ Layout::ALIGNMENT });
+            }
+        };
+
+        const std::size_t capacity_;
+        const std::unique_ptr<std::byte, SlotsDeleter> pool_;
+        FreeList freeList_;
+        const DynamicPoolItemDeleter<T, Traits> poolItemDeleter_;
+
+        [[nodiscard]] static std::byte* allocateSlots(std::size_t capacity) noexcept(false);
+
+        // nullptr once the pool is exhausted
+        template <typename... Args>
+        [[nodiscard]] T* tryConstruct(Args&&... args) noexcept(false);
+
+        void release(T* obj) noexcept;
+    };
+
+
+    template <PoolItemConcept T, typename Traits>
+    DynamicObjectPool<T, Traits>::DynamicObjectPool(std::size_t capacity) noexcept(false)
+        : capacity_{ capacity }
+        , pool_{ allocateSlots(capacity) }
+        , freeList_{ makeFreeList<FreeList, Layout::SIZE>(pool_.get(), capacity) }
+        , poolItemDeleter_{ *this }
+    { }
+
+    template <PoolItemConcept T, typename Traits>
+    std::byte* DynamicObjectPool<T, Traits>::allocateSlots(std::size_t capacity) noexcept(false)
+    {
+        if (capacity > std::numeric_limits<std::size_t>::max() / Layout::SIZE) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<std::bad_array_new_length>();
+        }
+
+        return static_cast<std::byte*>(::operator new(capacity * Layout::SIZE, std::align_val_t{ Layout::ALIGNMENT }));
+    }
+
+    template <PoolItemConcept T, typename Traits>
+    template <typename... Args>
+    DynamicPoolItem<T, Traits> DynamicObjectPool<T, Traits>::request(Args&&... args) noexcept(false)
+    {
+        T* const obj{ tryConstruct(std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
+        }
+
+        return { obj, poolItemDeleter_ };
+    }
+
+    template <PoolItemConcept T, typename Traits>
+    template <typename... Args>
+    std::optional<DynamicPoolItem<T, Traits>> DynamicObjectPool<T, Traits>::tryRequest(Args&&... args) noexcept(false)
+    {
+        T* const obj{ tryConstruct(std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
+        {
+            return std::nullopt;
+        }
+
+        return std::optional<DynamicPoolItem<T, Traits>>{ std::in_place, obj, poolItemDeleter_ };
+    }
+
+    template <PoolItemConcept T, typename Traits>
+    template <typename... Args>
+    T* DynamicObjectPool<T, Traits>::tryConstruct(Args&&... args) noexcept(false)
+    {
+        std::size_t idx;
+
+        if (!freeList_.acquire(idx)) [[unlikely]]
+        {
+            return nullptr;
+        }
+
+        return constructAt<T>(pool_.get() + idx * Layout::SIZE, std::forward<Args>(args)...);
+    }
+
+    template <PoolItemConcept T, typename Traits>
+    void DynamicObjectPool<T, Traits>::release(T* obj) noexcept
+    {
+        const std::size_t freedObjIdx{ static_cast<std::size_t>(reinterpret_cast<std::byte*>(obj) - pool_.get()) / Layout::SIZE };
+
+        freeList_.release(freedObjIdx);
+    }
+
+    template <PoolItemConcept T, typename Traits>
+    std::size_t DynamicObjectPool<T, Traits>::capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    template <PoolItemConcept T, typename Traits>
+    std::size_t DynamicObjectPool<T, Traits>::size() const noexcept
+    {
+        return freeList_.size();
+    }
+
+    template <PoolItemConcept T, typename Traits>
+    bool DynamicObjectPool<T, Traits>::isFull() const noexcept
+    {
+        return freeList_.size() == capacity_;
+    }
+}
+
+
+#endif // !DYNAMIC_OBJECT_POOL
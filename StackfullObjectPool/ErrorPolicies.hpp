@@ -0,0 +1,48 @@
+﻿#ifndef STACKFULL_OBJECT_POOL_ERROR_POLICIES
+#define STACKFULL_OBJECT_POOL_ERROR_POLICIES
+
+
+#include <cstdlib>
+#include <utility>
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define SOP_HAS_EXCEPTIONS
+#endif
+
+
+namespace sop
+{
+    // An error policy decides what happens where the pools would throw (e.g. max_capacity_exception on exhaustion),
+    // through a [[noreturn]] static fail<Exception>(args...) which is handed the exception's constructor arguments.
+
+
+    // Throws Exception{ args... }.
+    struct ThrowOnError
+    {
+        template <typename Exception, typename... Args>
+        [[noreturn]] static void fail(Args&&... args) noexcept(false)
+        {
+            throw Exception{ std::forward<Args>(args)... };
+        }
+    };
+
+    // Aborts, for builds with exceptions disabled (-fno-exceptions) - use the pools' tryRequest() to
+    // handle exhaustion without aborting.
+    struct AbortOnError
+    {
+        template <typename Exception, typename... Args>
+        [[noreturn]] static void fail(Args&&...) noexcept
+        {
+            std::abort();
+        }
+    };
+
+#ifdef SOP_HAS_EXCEPTIONS
+    using DefaultErrorPolicy = ThrowOnError;
+#else
+    using DefaultErrorPolicy = AbortOnError;
+#endif
+}
+
+
+#endif // !STACKFULL_OBJECT_POOL_ERROR_POLICIES
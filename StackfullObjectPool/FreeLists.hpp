@@ -0,0 +1,1762 @@
+﻿#ifndef STACKFULL_OBJECT_POOL_FREE_LISTS
+#define STACKFULL_OBJECT_POOL_FREE_LISTS
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ErrorPolicies.hpp"
+
+#if defined(__linux__) && __has_include(<sys/rseq.h>) && defined(__has_builtin)
+#if __has_builtin(__builtin_thread_pointer)
+#include <sys/rseq.h>
+#include <unistd.h>
+#define SOP_HAS_RSEQ
+#endif
+#endif
+
+#if defined(__linux__) && __has_include(<linux/membarrier.h>)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define SOP_HAS_MEMBARRIER
+#endif
+
+// GCC 12 crashes (internal compiler error) at -O3 inlining a function which returns a free list holding
+// a std::mutex into a member initializer, so makeFreeList() is kept out of line there.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ == 12
+#define SOP_MAKE_FREE_LIST_NOINLINE [[gnu::noinline]]
+#else
+#define SOP_MAKE_FREE_LIST_NOINLINE
+#endif
+
+
+namespace sop
+{
+    inline constexpr std::size_t CACHE_LINE_SIZE{ 64U };
+
+
+    // A free list hands out the indices of the pool's open slots.
+    // acquire() returns false once all CAPACITY indices are handed out,
+    // release() gives an index back, and size() counts the handed out indices.
+    // The optional span overloads move indices in bulk, acquire() returns how many indices it could fill in
+    // (acquireBulk() and releaseBulk() fall back to single indices without them).
+    // A free list constructible from (std::byte* slots, std::size_t slotSize) is handed the pool's slots.
+    // A free list whose CAPACITY is DYNAMIC_CAPACITY is handed its capacity at construction (LockedStack, TreiberStack).
+
+
+    // As with std::dynamic_extent, the capacity is only known at run time.
+    inline constexpr std::size_t DYNAMIC_CAPACITY{ std::numeric_limits<std::size_t>::max() };
+
+
+    // The narrowest unsigned type which holds every value up to MAX_VALUE.
+    template <std::size_t MAX_VALUE>
+    using UintFor = std::conditional_t<(MAX_VALUE <= std::numeric_limits<std::uint8_t>::max()), std::uint8_t,
+        std::conditional_t<(MAX_VALUE <= std::numeric_limits<std::uint16_t>::max()), std::uint16_t,
+        std::conditional_t<(MAX_VALUE <= std::numeric_limits<std::uint32_t>::max()), std::uint32_t, std::uint64_t>>>;
+
+    // The narrowest unsigned type which holds every slot index of a CAPACITY slots pool,
+    // used for the free lists' per-slot arrays so a small pool's bookkeeping stays small.
+    template <std::size_t CAPACITY>
+    using IndexFor = UintFor<(CAPACITY == 0U ? 0U : CAPACITY - 1U)>;
+
+    // A free list's per-slot array - a std::array of CAPACITY elements,
+    // or for DYNAMIC_CAPACITY a heap array sized at construction.
+    template <typename Element>
+    class DynamicArray
+    {
+    public:
+        explicit DynamicArray(std::size_t size) noexcept(false);
+
+        [[nodiscard]] Element& operator[](std::size_t i) noexcept;
+
+        [[nodiscard]] const Element& operator[](std::size_t i) const noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        const std::unique_ptr<Element[]> elements_;
+        const std::size_t size_;
+    };
+
+    template <typename Element, std::size_t CAPACITY>
+    using CapacityArray = std::conditional_t<(CAPACITY == DYNAMIC_CAPACITY), DynamicArray<Element>, std::array<Element, CAPACITY>>;
+
+    // Builds a free list for slots of SLOT_SIZE bytes starting at slots,
+    // handing it the slots if it keeps its bookkeeping inside them (IntrusiveStack), and args (a DYNAMIC_CAPACITY) if any.
+    template <typename FreeList, std::size_t SLOT_SIZE, typename... Args>
+    [[nodiscard]] SOP_MAKE_FREE_LIST_NOINLINE FreeList makeFreeList(std::byte* slots, Args... args)
+        noexcept(std::is_nothrow_constructible_v<FreeList, Args...> || std::is_nothrow_constructible_v<FreeList, std::byte*, std::size_t, Args...>)
+    {
+        if constexpr (std::is_constructible_v<FreeList, std::byte*, std::size_t, Args...>)
+        {
+            return FreeList{ slots, SLOT_SIZE, args... };
+        }
+        else
+        {
+            return FreeList{ args... };
+        }
+    }
+
+    // Whether a free list which keeps its links inside the slots has room for them in a SLOT_SIZE slot.
+    template <typename FreeList, std::size_t SLOT_SIZE>
+    inline constexpr bool FITS_FREE_LIST{ [] {
+        if constexpr (requires { typename FreeList::Link; })
+        {
+            return SLOT_SIZE >= sizeof(typename FreeList::Link);
+        }
+        else
+        {
+            return true;
+        }
+    }() };
+
+    // Acquires up to indices.size() indices through the free list's span overload, or one at a time from the free lists
+    // without one - the per-thread and per-CPU caches, whose single index calls stay off Central in the common case.
+    template <typename FreeList>
+    [[nodiscard]] std::size_t acquireBulk(FreeList& freeList, std::span<std::size_t> indices) noexcept
+    {
+        if constexpr (requires { { freeList.acquire(indices) } -> std::same_as<std::size_t>; })
+        {
+            return freeList.acquire(indices);
+        }
+        else
+        {
+            std::size_t count{ 0U };
+
+            while (count != indices.size() && freeList.acquire(indices[count]))
+            {
+                ++count;
+            }
+
+            return count;
+        }
+    }
+
+    // Releases indices through the free list's span overload, or one at a time as acquireBulk().
+    template <typename FreeList>
+    void releaseBulk(FreeList& freeList, std::span<const std::size_t> indices) noexcept
+    {
+        if constexpr (requires { freeList.release(indices); })
+        {
+            freeList.release(indices);
+        }
+        else
+        {
+            for (const std::size_t index : indices)
+            {
+                freeList.release(index);
+            }
+        }
+    }
+
+
+    // The original free list - a stack of open indices guarded by a std::mutex.
+    template <std::size_t CAPACITY>
+    class LockedStack
+    {
+    public:
+        using Index = IndexFor<CAPACITY>;
+
+        LockedStack() noexcept requires (CAPACITY != DYNAMIC_CAPACITY);
+
+        explicit LockedStack(std::size_t capacity) noexcept(false) requires (CAPACITY == DYNAMIC_CAPACITY);
+
+        [[nodiscard]] bool acquire(std::size_t& index) noexcept;
+
+        [[nodiscard]] std::size_t acquire(std::span<std::size_t> indices) noexcept;
+
+        void release(std::size_t index) noexcept;
+
+        void release(std::span<const std::size_t> indices) noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        CapacityArray<Index, CAPACITY> stack_;
+        std::size_t stackTop_;
+        std::mutex mutex_;
+
+        void fill() noexcept;
+    };
+
+
+    // Lock-free Treiber stack.
+    // The open indices are linked through next_ (CAPACITY marks the end), and the head packs the top index
+    // together with a tag that is bumped on every update, so a head which was popped
+    // and pushed back in between a thread's load and its CAS (ABA) fails the CAS.
+    template <std::size_t CAPACITY>
+    class TreiberStack
+    {
+        static_assert(CAPACITY == DYNAMIC_CAPACITY || CAPACITY < std::numeric_limits<std::uint32_t>::max(),
+            "TreiberStack packs an index and a tag into a 64 bit head, CAPACITY must fit in 32 bits.");
+
+    public:
+        TreiberStack() noexcept requires (CAPACITY != DYNAMIC_CAPACITY);
+
+        // fails with std::length_error unless capacity fits in 32 bits
+        explicit TreiberStack(std::size_t capacity) noexcept(false) requires (CAPACITY == DYNAMIC_CAPACITY);
+
+        [[nodiscard]] bool acquire(std::size_t& index) noexcept;
+
+        [[nodiscard]] std::size_t acquire(std::span<std::size_t> indices) noexcept;
+
+        void release(std::size_t index) noexcept;
+
+        void release(std::span<const std::size_t> indices) noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        using Link = UintFor<(CAPACITY == DYNAMIC_CAPACITY ? std::numeric_limits<std::uint32_t>::max() : CAPACITY)>;
+
+        static constexpr std::uint64_t INDEX_MASK{ std::numeric_limits<std::uint32_t>::max() };
+        static constexpr std::uint64_t TAG_STEP{ INDEX_MASK + 1U };
+
+        // next_.size() marks the end of the stack
+        CapacityArray<std::atomic<Link>, CAPACITY> next_;
+        alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> head_;
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> size_;
+
+        void fill() noexcept;
+
+        [[nodiscard]] static std::size_t checkedCapacity(std::size_t capacity) noexcept(false);
+    };
+
+
+    // A pair of fences for Dekker style handshakes where one side runs far more often than the other.
+    // On Linux heavy() is a membarrier() which makes every running thread of the process execute a full fence,
+    // so light() only has to keep the compiler from reordering. Elsewhere both are sequentially consistent fences.
+    class AsymmetricFence
+    {
+    public:
+        static void light() noexcept;
+
+        static void heavy() noexcept;
+
+    private:
+        // registers the process for expedited membarrier() once, returns whether it can be used
+        [[nodiscard]] static bool isExpedited() noexcept;
+    };
+
+
+    // Opt-in thread-local cache in front of a Central free list.
+    // Every thread keeps a magazine of up to MAGAZINE_SIZE open indices for each cache it uses,
+    // so requests and releases run unsynchronized until the magazine runs empty or full,
+    // at which point half a magazine is moved from/to Central under a single acquisition of it.
+    // A request which finds both its magazine and Central empty steals half of every other thread's magazine
+    // before giving up, so the pool's whole capacity stays reachable from any thread.
+    // A thread's magazines go back to Central when the thread exits.
+    template <typename Central, std::size_t MAGAZINE_SIZE = 32U>
+    class MagazineCache
+    {
+        static_assert(MAGAZINE_SIZE >= 2U, "a magazine must be able to hold at least two indices.");
+
+    public:
+        template <typename... Args>
+            requires std::is_constructible_v<Central, Args...>
+        explicit MagazineCache(Args&&... args) noexcept(std::is_nothrow_constructible_v<Central, Args...>);
+
+        ~MagazineCache();
+
+        MagazineCache(const MagazineCache&) = delete;
+        MagazineCache& operator=(const MagazineCache&) = delete;
+
+        [[nodiscard]] bool acquire(std::size_t& index) noexcept;
+
+        void release(std::size_t index) noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        // The owning thread marks its magazine busy for the length of every operation and a stealer claims it,
+        // each then checks the other's flag (Dekker style). The owner's side is a plain store and load,
+        // the stealer pays for the full fence of both through AsymmetricFence::heavy().
+        struct Magazine
+        {
+            // written by the owning thread, or by a stealer while it has the magazine claimed
+            std::array<std::atomic<std::size_t>, MAGAZINE_SIZE> indices;
+            std::atomic<std::size_t> count;
+            std::atomic<bool> busy;
+            std::atomic<bool> claimed;
+            // reset to nullptr when the cache is destroyed before the thread exits
+            MagazineCache* cache;
+        };
+
+        // the calling thread's magazines, one per cache it used, handed back on thread exit
+        class ThreadMagazines
+        {
+        public:
+            ~ThreadMagazines();
+
+            std::vector<std::pair<std::uint64_t, std::unique_ptr<Magazine>>> magazines_;
+        };
+
+        Central central_;
+        const std::uint64_t id_;
+        // guards magazines_, taken when a thread first uses this cache or exits, by size() and by a stealing request
+        mutable std::mutex magazinesMutex_;
+        std::vector<Magazine*> magazines_;
+
+        // guards Magazine::cache of every cache of this type, only taken when a thread first uses a cache,
+        // when it exits and when a cache is destroyed, always before magazinesMutex_
+        static std::mutex& registryMutex() noexcept;
+
+        [[nodiscard]] Magazine& localMagazine() noexcept;
+
+        // marks the calling thread's magazine busy, waiting out a stealer which has it claimed
+        static void enter(Magazine& magazine) noexcept;
+
+        static void leave(Magazine& magazine) noexcept;
+
+        // moves half of every other thread's magazine into the calling thread's empty one and takes an index of it
+        [[nodiscard]] bool steal(Magazine& magazine, std::size_t& index) noexcept;
+
+        void retire(Magazine& magazine) noexcept;
+    };
+
+
+    // Remote-free lists in the spirit of mimalloc.
+    // The first thread to acquire an index becomes the owner. Requests and the owner's releases
+    // use a stack guarded by a std::mutex, while releases from any other thread push onto a lock-free
+    // multi-producer list which never touches that mutex. A request that finds the stack empty takes
+    // the whole remote list with a single exchange and moves it onto the stack.
+    template <std::size_t CAPACITY>
+    class RemoteFreeList
+    {
+    public:
+        RemoteFreeList() noexcept;
+
+        [[nodiscard]] bool acquire(std::size_t& index) noexcept;
+
+        [[nodiscard]] std::size_t acquire(std::span<std::size_t> indices) noexcept;
+
+        void release(std::size_t index) noexcept;
+
+        void release(std::span<const std::size_t> indices) noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        using Index = IndexFor<CAPACITY>;
+        using Link = UintFor<CAPACITY>;
+
+        static constexpr Link EMPTY{ CAPACITY };
+
+        std::array<Index, CAPACITY> stack_;
+        // only written under mutex_, but atomic so size() may read it from any thread
+        std::atomic<std::size_t> stackTop_;
+        std::mutex mutex_;
+        std::atomic<std::thread::id> owner_;
+        // next_[i] is only written by the thread pushing i, and read by the owner after taking the list
+        std::array<Link, CAPACITY> next_;
+        alignas(CACHE_LINE_SIZE) std::atomic<Link> remoteHead_;
+        std::atomic<std::size_t> remoteCount_;
+
+        [[nodiscard]] bool isOwner() const noexcept;
+
+        // moves every remotely released index onto the stack, mutex_ must be held
+        void drainRemote() noexcept;
+    };
+
+
+    // Opt-in per-CPU cache in front of a Central free list.
+    // Every CPU gets a cache of up to CACHE_SIZE open indices which is refilled from and spilled to Central
+    // half a cache at a time, so the number of cached indices is bounded by the number of cores rather than threads.
+    // The current CPU is read from the rseq area the C library registers for every thread on Linux,
+    // but unlike tcmalloc's caches these don't run as restartable sequences: a CPU's cache is guarded by a try-lock
+    // which only the threads running on that CPU take, so it stays uncontended and on that core's cache line,
+    // yet every request and release still pays for an atomic exchange and a release store.
+    // On the rare preemption or migration that finds the cache taken, the request goes to Central instead.
+    // Without rseq (other platforms, or registration disabled) every request goes straight to Central.
+    // A request which finds both its cache and Central empty steals from the other CPUs' caches.
+    template <typename Central, std::size_t CACHE_SIZE = 32U>
+    class PerCpuLockedCache
+    {
+        static_assert(CACHE_SIZE >= 2U, "a cache must be able to hold at least two indices.");
+
+    public:
+        template <typename... Args>
+            requires std::is_constructible_v<Central, Args...>
+        explicit PerCpuLockedCache(Args&&... args) noexcept(std::is_nothrow_constructible_v<Central, Args...>);
+
+        [[nodiscard]] bool acquire(std::size_t& index) noexcept;
+
+        void release(std::size_t index) noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) CpuCache
+        {
+            std::atomic<bool> busy;
+            // written under busy, read by size()
+            std::atomic<std::size_t> count;
+            std::array<std::size_t, CACHE_SIZE> indices;
+        };
+
+        Central central_;
+        const std::size_t cpuCount_;
+        const std::unique_ptr<CpuCache[]> caches_;
+
+        // the number of configured CPUs, or 0 when the current CPU can't be read cheaply
+        [[nodiscard]] static std::size_t cpuCount() noexcept;
+
+        // locks the cache of the calling thread's CPU, returns nullptr when it's unavailable or taken
+        [[nodiscard]] CpuCache* lockLocalCache() noexcept;
+
+        [[nodiscard]] bool steal(std::size_t& index) noexcept;
+    };
+
+
+    // Lock-free occupancy bitmap for small pools, one bit per slot packed into 64 bit words.
+    // acquire() claims the lowest open slot with find-first-zero and a CAS, release() clears its bit with
+    // fetch_and, and size() is a popcount, so there's neither a mutex nor a per-slot index to pay for.
+    // The bits past CAPACITY in the last word are set up front, so they're never handed out.
+    template <std::size_t CAPACITY>
+    class AtomicBitmap
+    {
+    public:
+        AtomicBitmap() noexcept;
+
+        [[nodiscard]] bool acquire(std::size_t& index) noexcept;
+
+        [[nodiscard]] std::size_t acquire(std::span<std::size_t> indices) noexcept;
+
+        void release(std::size_t index) noexcept;
+
+        void release(std::span<const std::size_t> indices) noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        static constexpr std::size_t WORD_BITS{ 64U };
+        static constexpr std::size_t WORDS{ (CAPACITY + WORD_BITS - 1U) / WORD_BITS };
+        static constexpr std::size_t PADDING_BITS{ WORDS * WORD_BITS - CAPACITY };
+
+        std::array<std::atomic<std::uint64_t>, WORDS> words_;
+    };
+
+
+    // Occupancy bitmap for very large pools, guarded by a std::mutex.
+    // Each bit of the leaf words marks a slot in use, each bit of the middle words marks a full leaf word,
+    // and each bit of the top words marks a full middle word. Finding an open slot takes a countr_one
+    // (tzcnt) per level, starting from the lowest top word that isn't full, so slots are always
+    // handed out lowest address first. It needs about CAPACITY / 8 bytes rather than the stack's
+    // 8 * CAPACITY, and zero-initialized words rather than a fill loop to construct.
+    template <std::size_t CAPACITY>
+    class HierarchicalBitmap
+    {
+    public:
+        HierarchicalBitmap() noexcept;
+
+        [[nodiscard]] bool acquire(std::size_t& index) noexcept;
+
+        [[nodiscard]] std::size_t acquire(std::span<std::size_t> indices) noexcept;
+
+        void release(std::size_t index) noexcept;
+
+        void release(std::span<const std::size_t> indices) noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        static constexpr std::size_t WORD_BITS{ 64U };
+        static constexpr std::uint64_t FULL{ ~std::uint64_t{ 0U } };
+        static constexpr std::size_t LEAF_WORDS{ (CAPACITY + WORD_BITS - 1U) / WORD_BITS };
+        static constexpr std::size_t MIDDLE_WORDS{ (LEAF_WORDS + WORD_BITS - 1U) / WORD_BITS };
+        static constexpr std::size_t TOP_WORDS{ (MIDDLE_WORDS + WORD_BITS - 1U) / WORD_BITS };
+
+        std::array<std::uint64_t, LEAF_WORDS> leaves_;
+        std::array<std::uint64_t, MIDDLE_WORDS> middles_;
+        std::array<std::uint64_t, TOP_WORDS> tops_;
+        // no top word below firstOpenTop_ has an open slot
+        std::size_t firstOpenTop_;
+        std::size_t size_;
+        std::mutex mutex_;
+
+        // marks the bits past count in the last of words as taken, so they're never handed out
+        template <std::size_t WORDS>
+        static void fillPadding(std::array<std::uint64_t, WORDS>& words, std::size_t count) noexcept;
+
+        [[nodiscard]] bool acquireLocked(std::size_t& index) noexcept;
+
+        void releaseLocked(std::size_t index) noexcept;
+    };
+
+
+    // Free list threaded through the open slots themselves: an open slot's first bytes hold the index
+    // of the next open slot, so there's no per-slot bookkeeping at all, guarded by a std::mutex.
+    // Slots at or past the high-water mark were never handed out and are open implicitly,
+    // so construction doesn't touch the slots either.
+    // Links are the narrowest unsigned type that holds CAPACITY, and the pool rejects a T smaller than a Link.
+    template <std::size_t CAPACITY>
+    class IntrusiveStack
+    {
+    public:
+        using Link = UintFor<CAPACITY>;
+
+        IntrusiveStack(std::byte* slots, std::size_t slotSize) noexcept;
+
+        [[nodiscard]] bool acquire(std::size_t& index) noexcept;
+
+        [[nodiscard]] std::size_t acquire(std::span<std::size_t> indices) noexcept;
+
+        void release(std::size_t index) noexcept;
+
+        void release(std::span<const std::size_t> indices) noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+    private:
+        std::byte* const slots_;
+        const std::size_t slotSize_;
+        // CAPACITY when no released slot is linked
+        std::size_t head_;
+        std::size_t highWater_;
+        std::size_t size_;
+        std::mutex mutex_;
+
+        [[nodiscard]] bool acquireLocked(std::size_t& index) noexcept;
+
+        void releaseLocked(std::size_t index) noexcept;
+    };
+
+
+    // Pools of up to BITMAP_MAX_CAPACITY slots default to an AtomicBitmap, larger pools to a LockedStack.
+    inline constexpr std::size_t BITMAP_MAX_CAPACITY{ 512U };
+
+    template <std::size_t CAPACITY>
+    using DefaultFreeList = std::conditional_t<(CAPACITY <= BITMAP_MAX_CAPACITY), AtomicBitmap<CAPACITY>, LockedStack<CAPACITY>>;
+
+
+    template <typename Element>
+    DynamicArray<Element>::DynamicArray(std::size_t size) noexcept(false)
+        : elements_{ std::make_unique<Element[]>(size) }
+        , size_{ size }
+    { }
+
+    template <typename Element>
+    Element& DynamicArray<Element>::operator[](std::size_t i) noexcept
+    {
+        return elements_[i];
+    }
+
+    template <typename Element>
+    const Element& DynamicArray<Element>::operator[](std::size_t i) const noexcept
+    {
+        return elements_[i];
+    }
+
+    template <typename Element>
+    std::size_t DynamicArray<Element>::size() const noexcept
+    {
+        return size_;
+    }
+
+
+    template <std::size_t CAPACITY>
+    LockedStack<CAPACITY>::LockedStack() noexcept requires (CAPACITY != DYNAMIC_CAPACITY)
+        : stack_{}
+        , stackTop_{ 0U }
+        , mutex_{}
+    {
+        fill();
+    }
+
+    template <std::size_t CAPACITY>
+    LockedStack<CAPACITY>::LockedStack(std::size_t capacity) noexcept(false) requires (CAPACITY == DYNAMIC_CAPACITY)
+        : stack_{ capacity }
+        , stackTop_{ 0U }
+        , mutex_{}
+    {
+        fill();
+    }
+
+    template <std::size_t CAPACITY>
+    void LockedStack<CAPACITY>::fill() noexcept
+    {
+        for (std::size_t i{ 0U }; i != stack_.size(); ++i)
+        {
+            stack_[i] = static_cast<Index>(i);
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    bool LockedStack<CAPACITY>::acquire(std::size_t& index) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        if (stackTop_ == stack_.size()) [[unlikely]]
+        {
+            return false;
+        }
+
+        index = stack_[stackTop_];
+        ++stackTop_;
+
+        return true;
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t LockedStack<CAPACITY>::acquire(std::span<std::size_t> indices) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        const std::size_t count{ std::min(indices.size(), stack_.size() - stackTop_) };
+
+        for (std::size_t i{ 0U }; i != count; ++i)
+        {
+            indices[i] = stack_[stackTop_];
+            ++stackTop_;
+        }
+
+        return count;
+    }
+
+    template <std::size_t CAPACITY>
+    void LockedStack<CAPACITY>::release(std::size_t index) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        --stackTop_;
+        stack_[stackTop_] = static_cast<Index>(index);
+    }
+
+    template <std::size_t CAPACITY>
+    void LockedStack<CAPACITY>::release(std::span<const std::size_t> indices) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        for (const std::size_t index : indices)
+        {
+            --stackTop_;
+            stack_[stackTop_] = static_cast<Index>(index);
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t LockedStack<CAPACITY>::size() const noexcept
+    {
+        return stackTop_;
+    }
+
+
+    template <std::size_t CAPACITY>
+    TreiberStack<CAPACITY>::TreiberStack() noexcept requires (CAPACITY != DYNAMIC_CAPACITY)
+        : next_{}
+        , head_{ 0U }
+        , size_{ 0U }
+    {
+        fill();
+    }
+
+    template <std::size_t CAPACITY>
+    TreiberStack<CAPACITY>::TreiberStack(std::size_t capacity) noexcept(false) requires (CAPACITY == DYNAMIC_CAPACITY)
+        : next_{ checkedCapacity(capacity) }
+        , head_{ 0U }
+        , size_{ 0U }
+    {
+        fill();
+    }
+
+    template <std::size_t CAPACITY>
+    void TreiberStack<CAPACITY>::fill() noexcept
+    {
+        for (std::size_t i{ 0U }; i != next_.size(); ++i)
+        {
+            next_[i].store(static_cast<Link>(i + 1U), std::memory_order_relaxed);
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t TreiberStack<CAPACITY>::checkedCapacity(std::size_t capacity) noexcept(false)
+    {
+        if (capacity >= INDEX_MASK) [[unlikely]]
+        {
+            DefaultErrorPolicy::fail<std::length_error>("TreiberStack capacity must fit in 32 bits.");
+        }
+
+        return capacity;
+    }
+
+    template <std::size_t CAPACITY>
+    bool TreiberStack<CAPACITY>::acquire(std::size_t& index) noexcept
+    {
+        std::uint64_t head{ head_.load(std::memory_order_acquire) };
+        std::uint64_t newHead;
+
+        do
+        {
+            if ((head & INDEX_MASK) == next_.size()) [[unlikely]]
+            {
+                return false;
+            }
+
+            // next_ of a stale head may be rewritten concurrently, in which case the tag makes the CAS fail
+            const std::uint64_t next{ next_[head & INDEX_MASK].load(std::memory_order_relaxed) };
+            newHead = ((head & ~INDEX_MASK) + TAG_STEP) | next;
+        } while (!head_.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire));
+
+        index = static_cast<std::size_t>(head & INDEX_MASK);
+        size_.fetch_add(1U, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t TreiberStack<CAPACITY>::acquire(std::span<std::size_t> indices) noexcept
+    {
+        std::uint64_t head{ head_.load(std::memory_order_acquire) };
+        std::uint64_t newHead;
+        std::size_t count;
+
+        // pops the top indices.size() indices with a single CAS
+        do
+        {
+            std::size_t top{ static_cast<std::size_t>(head & INDEX_MASK) };
+            count = 0U;
+
+            // a stale walk may read links rewritten concurrently (bounded by indices.size() even if they loop),
+            // in which case the tag makes the CAS fail
+            while (count != indices.size() && top != next_.size())
+            {
+                indices[count] = top;
+                ++count;
+                top = next_[top].load(std::memory_order_relaxed);
+            }
+
+            if (count == 0U)
+            {
+                return 0U;
+            }
+
+            newHead = ((head & ~INDEX_MASK) + TAG_STEP) | top;
+        } while (!head_.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire));
+
+        size_.fetch_add(count, std::memory_order_relaxed);
+
+        return count;
+    }
+
+    template <std::size_t CAPACITY>
+    void TreiberStack<CAPACITY>::release(std::size_t index) noexcept
+    {
+        size_.fetch_sub(1U, std::memory_order_relaxed);
+
+        std::uint64_t head{ head_.load(std::memory_order_relaxed) };
+        std::uint64_t newHead;
+
+        do
+        {
+            next_[index].store(static_cast<Link>(head & INDEX_MASK), std::memory_order_relaxed);
+            newHead = ((head & ~INDEX_MASK) + TAG_STEP) | index;
+        } while (!head_.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    template <std::size_t CAPACITY>
+    void TreiberStack<CAPACITY>::release(std::span<const std::size_t> indices) noexcept
+    {
+        if (indices.empty())
+        {
+            return;
+        }
+
+        // chains the indices up front, then pushes the whole chain with a single CAS
+        for (std::size_t i{ 1U }; i != indices.size(); ++i)
+        {
+            next_[indices[i - 1U]].store(static_cast<Link>(indices[i]), std::memory_order_relaxed);
+        }
+
+        size_.fetch_sub(indices.size(), std::memory_order_relaxed);
+
+        std::uint64_t head{ head_.load(std::memory_order_relaxed) };
+        std::uint64_t newHead;
+
+        do
+        {
+            next_[indices.back()].store(static_cast<Link>(head & INDEX_MASK), std::memory_order_relaxed);
+            newHead = ((head & ~INDEX_MASK) + TAG_STEP) | indices.front();
+        } while (!head_.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t TreiberStack<CAPACITY>::size() const noexcept
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    inline void AsymmetricFence::light() noexcept
+    {
+        if (isExpedited()) [[likely]]
+        {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+        else
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    inline void AsymmetricFence::heavy() noexcept
+    {
+#ifdef SOP_HAS_MEMBARRIER
+        if (isExpedited() && syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0U, 0) == 0)
+        {
+            return;
+        }
+#endif
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    inline bool AsymmetricFence::isExpedited() noexcept
+    {
+#ifdef SOP_HAS_MEMBARRIER
+        static const bool expedited{ [] {
+            const long commands{ syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0U, 0) };
+
+            return commands > 0 && (commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED) != 0
+                && syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0U, 0) == 0;
+        }() };
+
+        return expedited;
+#else
+        return false;
+#endif
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    template <typename... Args>
+        requires std::is_constructible_v<Central, Args...>
+    MagazineCache<Central, MAGAZINE_SIZE>::MagazineCache(Args&&... args) noexcept(std::is_nothrow_constructible_v<Central, Args...>)
+        : central_{ std::forward<Args>(args)... }
+        , id_{ [] { static std::atomic<std::uint64_t> nextId{ 1U }; return nextId.fetch_add(1U, std::memory_order_relaxed); }() }
+        , magazinesMutex_{}
+        , magazines_{}
+    { }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    MagazineCache<Central, MAGAZINE_SIZE>::~MagazineCache()
+    {
+        std::lock_guard lock{ registryMutex() };
+
+        for (Magazine* magazine : magazines_)
+        {
+            magazine->cache = nullptr;
+        }
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    bool MagazineCache<Central, MAGAZINE_SIZE>::acquire(std::size_t& index) noexcept
+    {
+        Magazine& magazine{ localMagazine() };
+        enter(magazine);
+
+        std::size_t count{ magazine.count.load(std::memory_order_relaxed) };
+
+        if (count == 0U) [[unlikely]]
+        {
+            std::array<std::size_t, MAGAZINE_SIZE / 2U> refill;
+            count = central_.acquire(std::span<std::size_t>{ refill });
+
+            for (std::size_t i{ 0U }; i != count; ++i)
+            {
+                magazine.indices[i].store(refill[i], std::memory_order_relaxed);
+            }
+        }
+
+        if (count == 0U) [[unlikely]]
+        {
+            leave(magazine);
+
+            // stealing claims other magazines, so it mustn't hold this one busy
+            return steal(magazine, index);
+        }
+
+        --count;
+        index = magazine.indices[count].load(std::memory_order_relaxed);
+        magazine.count.store(count, std::memory_order_relaxed);
+        leave(magazine);
+
+        return true;
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    void MagazineCache<Central, MAGAZINE_SIZE>::release(std::size_t index) noexcept
+    {
+        Magazine& magazine{ localMagazine() };
+        enter(magazine);
+
+        std::size_t count{ magazine.count.load(std::memory_order_relaxed) };
+
+        if (count == MAGAZINE_SIZE) [[unlikely]]
+        {
+            std::array<std::size_t, MAGAZINE_SIZE - MAGAZINE_SIZE / 2U> spill;
+            count = MAGAZINE_SIZE / 2U;
+
+            for (std::size_t i{ 0U }; i != spill.size(); ++i)
+            {
+                spill[i] = magazine.indices[count + i].load(std::memory_order_relaxed);
+            }
+
+            // the spilled indices leave the magazine before they reach Central, so size() never counts them twice
+            magazine.count.store(count, std::memory_order_relaxed);
+            central_.release(std::span<const std::size_t>{ spill });
+        }
+
+        magazine.indices[count].store(index, std::memory_order_relaxed);
+        magazine.count.store(count + 1U, std::memory_order_relaxed);
+        leave(magazine);
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    std::size_t MagazineCache<Central, MAGAZINE_SIZE>::size() const noexcept
+    {
+        std::lock_guard lock{ magazinesMutex_ };
+
+        std::size_t cached{ 0U };
+
+        for (const Magazine* magazine : magazines_)
+        {
+            cached += magazine->count.load(std::memory_order_relaxed);
+        }
+
+        // indices on their way between a magazine and Central may be missed by one count and seen by the other
+        const std::size_t acquired{ central_.size() };
+
+        return acquired > cached ? acquired - cached : 0U;
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    std::mutex& MagazineCache<Central, MAGAZINE_SIZE>::registryMutex() noexcept
+    {
+        static std::mutex mutex{};
+
+        return mutex;
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    typename MagazineCache<Central, MAGAZINE_SIZE>::Magazine& MagazineCache<Central, MAGAZINE_SIZE>::localMagazine() noexcept
+    {
+        thread_local ThreadMagazines threadMagazines{};
+        // the last cache used by this thread, ids are never reused so a destroyed cache can't be mistaken for a new one
+        thread_local std::uint64_t lastId{ 0U };
+        thread_local Magazine* lastMagazine{ nullptr };
+
+        if (lastId == id_) [[likely]]
+        {
+            return *lastMagazine;
+        }
+
+        auto& magazines{ threadMagazines.magazines_ };
+        auto it{ std::find_if(magazines.begin(), magazines.end(), [this](const auto& entry) { return entry.first == id_; }) };
+
+        if (it == magazines.end()) [[unlikely]]
+        {
+            std::lock_guard lock{ registryMutex() };
+
+            // drop the magazines of caches that were destroyed in the meantime
+            std::erase_if(magazines, [](const auto& entry) { return entry.second->cache == nullptr; });
+
+            magazines.emplace_back(id_, new Magazine{ {}, 0U, false, false, this });
+
+            std::lock_guard magazinesLock{ magazinesMutex_ };
+            magazines_.push_back(magazines.back().second.get());
+            it = std::prev(magazines.end());
+        }
+
+        lastId = id_;
+        lastMagazine = it->second.get();
+
+        return *lastMagazine;
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    void MagazineCache<Central, MAGAZINE_SIZE>::enter(Magazine& magazine) noexcept
+    {
+        for (;;)
+        {
+            magazine.busy.store(true, std::memory_order_relaxed);
+            AsymmetricFence::light();
+
+            if (!magazine.claimed.load(std::memory_order_acquire)) [[likely]]
+            {
+                return;
+            }
+
+            magazine.busy.store(false, std::memory_order_release);
+
+            while (magazine.claimed.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    void MagazineCache<Central, MAGAZINE_SIZE>::leave(Magazine& magazine) noexcept
+    {
+        magazine.busy.store(false, std::memory_order_release);
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    bool MagazineCache<Central, MAGAZINE_SIZE>::steal(Magazine& magazine, std::size_t& index) noexcept
+    {
+        // one stealer at a time, and the calling thread's magazine can't be claimed while it holds the mutex
+        std::lock_guard lock{ magazinesMutex_ };
+
+        std::size_t count{ 0U };
+
+        for (Magazine* victim : magazines_)
+        {
+            if (victim == &magazine || victim->count.load(std::memory_order_relaxed) == 0U)
+            {
+                continue;
+            }
+
+            victim->claimed.store(true, std::memory_order_relaxed);
+            AsymmetricFence::heavy();
+
+            while (victim->busy.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+
+            const std::size_t victimCount{ victim->count.load(std::memory_order_relaxed) };
+            const std::size_t stolen{ std::min((victimCount + 1U) / 2U, MAGAZINE_SIZE - count) };
+
+            victim->count.store(victimCount - stolen, std::memory_order_relaxed);
+
+            for (std::size_t i{ victimCount - stolen }; i != victimCount; ++i, ++count)
+            {
+                magazine.indices[count].store(victim->indices[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+
+            victim->claimed.store(false, std::memory_order_release);
+
+            if (count == MAGAZINE_SIZE)
+            {
+                break;
+            }
+        }
+
+        if (count == 0U)
+        {
+            // another thread may have spilled to Central or exited while this one was looking
+            return central_.acquire(index);
+        }
+
+        --count;
+        index = magazine.indices[count].load(std::memory_order_relaxed);
+        magazine.count.store(count, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    void MagazineCache<Central, MAGAZINE_SIZE>::retire(Magazine& magazine) noexcept
+    {
+        std::lock_guard lock{ magazinesMutex_ };
+
+        std::array<std::size_t, MAGAZINE_SIZE> indices;
+        const std::size_t count{ magazine.count.load(std::memory_order_relaxed) };
+
+        for (std::size_t i{ 0U }; i != count; ++i)
+        {
+            indices[i] = magazine.indices[i].load(std::memory_order_relaxed);
+        }
+
+        magazine.count.store(0U, std::memory_order_relaxed);
+        central_.release(std::span<const std::size_t>{ indices.data(), count });
+
+        std::erase(magazines_, &magazine);
+    }
+
+    template <typename Central, std::size_t MAGAZINE_SIZE>
+    MagazineCache<Central, MAGAZINE_SIZE>::ThreadMagazines::~ThreadMagazines()
+    {
+        std::lock_guard lock{ registryMutex() };
+
+        for (auto& [id, magazine] : magazines_)
+        {
+            if (magazine->cache != nullptr)
+            {
+                magazine->cache->retire(*magazine);
+            }
+        }
+    }
+
+
+    template <std::size_t CAPACITY>
+    RemoteFreeList<CAPACITY>::RemoteFreeList() noexcept
+        : stack_{}
+        , stackTop_{ 0U }
+        , mutex_{}
+        , owner_{}
+        , next_{}
+        , remoteHead_{ EMPTY }
+        , remoteCount_{ 0U }
+    {
+        for (std::size_t i{ 0U }; i != CAPACITY; ++i)
+        {
+            stack_[i] = static_cast<Index>(i);
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    bool RemoteFreeList<CAPACITY>::acquire(std::size_t& index) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        if (owner_.load(std::memory_order_relaxed) == std::thread::id{}) [[unlikely]]
+        {
+            owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        }
+
+        if (stackTop_.load(std::memory_order_relaxed) == CAPACITY) [[unlikely]]
+        {
+            drainRemote();
+
+            if (stackTop_.load(std::memory_order_relaxed) == CAPACITY)
+            {
+                return false;
+            }
+        }
+
+        const std::size_t top{ stackTop_.load(std::memory_order_relaxed) };
+        index = stack_[top];
+        stackTop_.store(top + 1U, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t RemoteFreeList<CAPACITY>::acquire(std::span<std::size_t> indices) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        if (owner_.load(std::memory_order_relaxed) == std::thread::id{}) [[unlikely]]
+        {
+            owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        }
+
+        if (CAPACITY - stackTop_.load(std::memory_order_relaxed) < indices.size())
+        {
+            drainRemote();
+        }
+
+        const std::size_t top{ stackTop_.load(std::memory_order_relaxed) };
+        const std::size_t count{ std::min(indices.size(), CAPACITY - top) };
+
+        for (std::size_t i{ 0U }; i != count; ++i)
+        {
+            indices[i] = stack_[top + i];
+        }
+
+        stackTop_.store(top + count, std::memory_order_relaxed);
+
+        return count;
+    }
+
+    template <std::size_t CAPACITY>
+    void RemoteFreeList<CAPACITY>::release(std::size_t index) noexcept
+    {
+        release(std::span<const std::size_t>{ &index, 1U });
+    }
+
+    template <std::size_t CAPACITY>
+    void RemoteFreeList<CAPACITY>::release(std::span<const std::size_t> indices) noexcept
+    {
+        if (indices.empty())
+        {
+            return;
+        }
+
+        if (isOwner())
+        {
+            std::lock_guard lock{ mutex_ };
+
+            std::size_t top{ stackTop_.load(std::memory_order_relaxed) };
+
+            for (const std::size_t index : indices)
+            {
+                --top;
+                stack_[top] = static_cast<Index>(index);
+            }
+
+            stackTop_.store(top, std::memory_order_relaxed);
+
+            return;
+        }
+
+        remoteCount_.fetch_add(indices.size(), std::memory_order_relaxed);
+
+        // link the indices into a chain and splice it in front of the remote list with a single CAS
+        for (std::size_t i{ 1U }; i != indices.size(); ++i)
+        {
+            next_[indices[i - 1U]] = static_cast<Link>(indices[i]);
+        }
+
+        const std::size_t last{ indices.back() };
+        Link head{ remoteHead_.load(std::memory_order_relaxed) };
+
+        do
+        {
+            next_[last] = head;
+        } while (!remoteHead_.compare_exchange_weak(head, static_cast<Link>(indices.front()),
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t RemoteFreeList<CAPACITY>::size() const noexcept
+    {
+        // the two counters are read at different times, so a racing drain or release may briefly make the difference negative
+        const std::size_t acquired{ stackTop_.load(std::memory_order_relaxed) };
+        const std::size_t remote{ remoteCount_.load(std::memory_order_relaxed) };
+
+        return acquired > remote ? acquired - remote : 0U;
+    }
+
+    template <std::size_t CAPACITY>
+    bool RemoteFreeList<CAPACITY>::isOwner() const noexcept
+    {
+        return owner_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+    }
+
+    template <std::size_t CAPACITY>
+    void RemoteFreeList<CAPACITY>::drainRemote() noexcept
+    {
+        Link head{ remoteHead_.exchange(EMPTY, std::memory_order_acquire) };
+        const std::size_t top{ stackTop_.load(std::memory_order_relaxed) };
+        std::size_t count{ 0U };
+
+        while (head != EMPTY)
+        {
+            ++count;
+            stack_[top - count] = static_cast<Index>(head);
+            head = next_[head];
+        }
+
+        // uncount the remote indices before lowering the top, so size() over-reports in between rather than under
+        remoteCount_.fetch_sub(count, std::memory_order_relaxed);
+        stackTop_.store(top - count, std::memory_order_relaxed);
+    }
+
+
+    template <typename Central, std::size_t CACHE_SIZE>
+    template <typename... Args>
+        requires std::is_constructible_v<Central, Args...>
+    PerCpuLockedCache<Central, CACHE_SIZE>::PerCpuLockedCache(Args&&... args) noexcept(std::is_nothrow_constructible_v<Central, Args...>)
+        : central_{ std::forward<Args>(args)... }
+        , cpuCount_{ cpuCount() }
+        , caches_{ cpuCount_ == 0U ? nullptr : new CpuCache[cpuCount_]{} }
+    { }
+
+    template <typename Central, std::size_t CACHE_SIZE>
+    bool PerCpuLockedCache<Central, CACHE_SIZE>::acquire(std::size_t& index) noexcept
+    {
+        if (CpuCache* cache{ lockLocalCache() }; cache != nullptr) [[likely]]
+        {
+            std::size_t count{ cache->count.load(std::memory_order_relaxed) };
+
+            if (count == 0U) [[unlikely]]
+            {
+                count = central_.acquire(std::span<std::size_t>{ cache->indices.data(), CACHE_SIZE / 2U });
+            }
+
+            if (count != 0U) [[likely]]
+            {
+                --count;
+                index = cache->indices[count];
+                cache->count.store(count, std::memory_order_relaxed);
+                cache->busy.store(false, std::memory_order_release);
+
+                return true;
+            }
+
+            cache->busy.store(false, std::memory_order_release);
+        }
+        else if (central_.acquire(index))
+        {
+            return true;
+        }
+
+        return steal(index);
+    }
+
+    template <typename Central, std::size_t CACHE_SIZE>
+    void PerCpuLockedCache<Central, CACHE_SIZE>::release(std::size_t index) noexcept
+    {
+        CpuCache* cache{ lockLocalCache() };
+
+        if (cache == nullptr) [[unlikely]]
+        {
+            central_.release(index);
+
+            return;
+        }
+
+        std::size_t count{ cache->count.load(std::memory_order_relaxed) };
+
+        if (count == CACHE_SIZE) [[unlikely]]
+        {
+            count = CACHE_SIZE / 2U;
+
+            // the spilled indices leave the cache before they reach Central, so size() never counts them twice
+            std::array<std::size_t, CACHE_SIZE - CACHE_SIZE / 2U> spill;
+            std::copy(cache->indices.begin() + count, cache->indices.end(), spill.begin());
+            cache->count.store(count, std::memory_order_relaxed);
+            central_.release(std::span<const std::size_t>{ spill });
+        }
+
+        cache->indices[count] = index;
+        cache->count.store(count + 1U, std::memory_order_relaxed);
+        cache->busy.store(false, std::memory_order_release);
+    }
+
+    template <typename Central, std::size_t CACHE_SIZE>
+    std::size_t PerCpuLockedCache<Central, CACHE_SIZE>::size() const noexcept
+    {
+        std::size_t cached{ 0U };
+
+        for (std::size_t cpu{ 0U }; cpu != cpuCount_; ++cpu)
+        {
+            cached += caches_[cpu].count.load(std::memory_order_relaxed);
+        }
+
+        // indices on their way between a cache and Central may be missed by one count and seen by the other
+        const std::size_t acquired{ central_.size() };
+
+        return acquired > cached ? acquired - cached : 0U;
+    }
+
+    template <typename Central, std::size_t CACHE_SIZE>
+    std::size_t PerCpuLockedCache<Central, CACHE_SIZE>::cpuCount() noexcept
+    {
+#ifdef SOP_HAS_RSEQ
+        if (__rseq_size != 0U)
+        {
+            const long cpus{ ::sysconf(_SC_NPROCESSORS_CONF) };
+
+            return cpus > 0 ? static_cast<std::size_t>(cpus) : 0U;
+        }
+#endif
+
+        return 0U;
+    }
+
+    template <typename Central, std::size_t CACHE_SIZE>
+    typename PerCpuLockedCache<Central, CACHE_SIZE>::CpuCache* PerCpuLockedCache<Central, CACHE_SIZE>::lockLocalCache() noexcept
+    {
+#ifdef SOP_HAS_RSEQ
+        if (cpuCount_ != 0U) [[likely]]
+        {
+            const auto* rseqArea{ reinterpret_cast<const volatile struct rseq*>(
+                static_cast<const char*>(__builtin_thread_pointer()) + __rseq_offset) };
+            const std::size_t cpu{ rseqArea->cpu_id };
+
+            // cpu_id holds a huge value while the thread's registration is pending or failed
+            if (cpu < cpuCount_ && !caches_[cpu].busy.exchange(true, std::memory_order_acquire)) [[likely]]
+            {
+                return &caches_[cpu];
+            }
+        }
+#endif
+
+        return nullptr;
+    }
+
+    template <typename Central, std::size_t CACHE_SIZE>
+    bool PerCpuLockedCache<Central, CACHE_SIZE>::steal(std::size_t& index) noexcept
+    {
+        for (std::size_t cpu{ 0U }; cpu != cpuCount_; ++cpu)
+        {
+            CpuCache& cache{ caches_[cpu] };
+
+            if (cache.count.load(std::memory_order_relaxed) == 0U || cache.busy.exchange(true, std::memory_order_acquire))
+            {
+                continue;
+            }
+
+            const std::size_t count{ cache.count.load(std::memory_order_relaxed) };
+
+            if (count != 0U)
+            {
+                index = cache.indices[count - 1U];
+                cache.count.store(count - 1U, std::memory_order_relaxed);
+            }
+
+            cache.busy.store(false, std::memory_order_release);
+
+            if (count != 0U)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    template <std::size_t CAPACITY>
+    AtomicBitmap<CAPACITY>::AtomicBitmap() noexcept
+        : words_{}
+    {
+        if constexpr (PADDING_BITS != 0U)
+        {
+            words_[WORDS - 1U].store(~std::uint64_t{ 0U } << (WORD_BITS - PADDING_BITS), std::memory_order_relaxed);
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    bool AtomicBitmap<CAPACITY>::acquire(std::size_t& index) noexcept
+    {
+        for (std::size_t word{ 0U }; word != WORDS; ++word)
+        {
+            std::uint64_t bits{ words_[word].load(std::memory_order_relaxed) };
+
+            while (bits != ~std::uint64_t{ 0U })
+            {
+                const int bit{ std::countr_one(bits) };
+
+                if (words_[word].compare_exchange_weak(bits, bits | (std::uint64_t{ 1U } << bit),
+                    std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    index = word * WORD_BITS + static_cast<std::size_t>(bit);
+
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t AtomicBitmap<CAPACITY>::acquire(std::span<std::size_t> indices) noexcept
+    {
+        std::size_t count{ 0U };
+
+        for (std::size_t word{ 0U }; word != WORDS && count != indices.size(); ++word)
+        {
+            std::uint64_t bits{ words_[word].load(std::memory_order_relaxed) };
+
+            while (bits != ~std::uint64_t{ 0U } && count != indices.size())
+            {
+                // claim as many of the word's open bits as are still needed with a single CAS
+                std::uint64_t open{ ~bits };
+                std::uint64_t claim{ 0U };
+
+                for (std::size_t claimed{ count }; open != 0U && claimed != indices.size(); ++claimed)
+                {
+                    claim |= open & (~open + 1U);
+                    open &= open - 1U;
+                }
+
+                if (words_[word].compare_exchange_weak(bits, bits | claim, std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    bits |= claim;
+
+                    for (; claim != 0U; claim &= claim - 1U)
+                    {
+                        indices[count] = word * WORD_BITS + static_cast<std::size_t>(std::countr_zero(claim));
+                        ++count;
+                    }
+                }
+            }
+        }
+
+        return count;
+    }
+
+    template <std::size_t CAPACITY>
+    void AtomicBitmap<CAPACITY>::release(std::size_t index) noexcept
+    {
+        words_[index / WORD_BITS].fetch_and(~(std::uint64_t{ 1U } << (index % WORD_BITS)), std::memory_order_release);
+    }
+
+    template <std::size_t CAPACITY>
+    void AtomicBitmap<CAPACITY>::release(std::span<const std::size_t> indices) noexcept
+    {
+        // clear runs of indices which share a word with a single fetch_and
+        std::size_t word{ 0U };
+        std::uint64_t mask{ 0U };
+
+        for (const std::size_t index : indices)
+        {
+            if (index / WORD_BITS != word && mask != 0U)
+            {
+                words_[word].fetch_and(~mask, std::memory_order_release);
+                mask = 0U;
+            }
+
+            word = index / WORD_BITS;
+            mask |= std::uint64_t{ 1U } << (index % WORD_BITS);
+        }
+
+        if (mask != 0U)
+        {
+            words_[word].fetch_and(~mask, std::memory_order_release);
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t AtomicBitmap<CAPACITY>::size() const noexcept
+    {
+        std::size_t size{ 0U };
+
+        for (const auto& word : words_)
+        {
+            size += static_cast<std::size_t>(std::popcount(word.load(std::memory_order_relaxed)));
+        }
+
+        return size - PADDING_BITS;
+    }
+
+
+    template <std::size_t CAPACITY>
+    HierarchicalBitmap<CAPACITY>::HierarchicalBitmap() noexcept
+        : leaves_{}
+        , middles_{}
+        , tops_{}
+        , firstOpenTop_{ 0U }
+        , size_{ 0U }
+        , mutex_{}
+    {
+        fillPadding(leaves_, CAPACITY);
+        fillPadding(middles_, LEAF_WORDS);
+        fillPadding(tops_, MIDDLE_WORDS);
+    }
+
+    template <std::size_t CAPACITY>
+    bool HierarchicalBitmap<CAPACITY>::acquire(std::size_t& index) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        return acquireLocked(index);
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t HierarchicalBitmap<CAPACITY>::acquire(std::span<std::size_t> indices) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        std::size_t count{ 0U };
+
+        while (count != indices.size() && acquireLocked(indices[count]))
+        {
+            ++count;
+        }
+
+        return count;
+    }
+
+    template <std::size_t CAPACITY>
+    void HierarchicalBitmap<CAPACITY>::release(std::size_t index) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        releaseLocked(index);
+    }
+
+    template <std::size_t CAPACITY>
+    void HierarchicalBitmap<CAPACITY>::release(std::span<const std::size_t> indices) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        for (const std::size_t index : indices)
+        {
+            releaseLocked(index);
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t HierarchicalBitmap<CAPACITY>::size() const noexcept
+    {
+        return size_;
+    }
+
+    template <std::size_t CAPACITY>
+    template <std::size_t WORDS>
+    void HierarchicalBitmap<CAPACITY>::fillPadding(std::array<std::uint64_t, WORDS>& words, std::size_t count) noexcept
+    {
+        if (count % WORD_BITS != 0U)
+        {
+            words[WORDS - 1U] = FULL << (count % WORD_BITS);
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    bool HierarchicalBitmap<CAPACITY>::acquireLocked(std::size_t& index) noexcept
+    {
+        while (firstOpenTop_ != TOP_WORDS && tops_[firstOpenTop_] == FULL)
+        {
+            ++firstOpenTop_;
+        }
+
+        if (firstOpenTop_ == TOP_WORDS) [[unlikely]]
+        {
+            return false;
+        }
+
+        const std::size_t top{ firstOpenTop_ };
+        const std::size_t middle{ top * WORD_BITS + static_cast<std::size_t>(std::countr_one(tops_[top])) };
+        const std::size_t leaf{ middle * WORD_BITS + static_cast<std::size_t>(std::countr_one(middles_[middle])) };
+        const int bit{ std::countr_one(leaves_[leaf]) };
+
+        leaves_[leaf] |= std::uint64_t{ 1U } << bit;
+
+        if (leaves_[leaf] == FULL)
+        {
+            middles_[middle] |= std::uint64_t{ 1U } << (leaf % WORD_BITS);
+
+            if (middles_[middle] == FULL)
+            {
+                tops_[top] |= std::uint64_t{ 1U } << (middle % WORD_BITS);
+            }
+        }
+
+        ++size_;
+        index = leaf * WORD_BITS + static_cast<std::size_t>(bit);
+
+        return true;
+    }
+
+    template <std::size_t CAPACITY>
+    void HierarchicalBitmap<CAPACITY>::releaseLocked(std::size_t index) noexcept
+    {
+        const std::size_t leaf{ index / WORD_BITS };
+        const std::size_t middle{ leaf / WORD_BITS };
+        const std::size_t top{ middle / WORD_BITS };
+
+        // a full word's summary bit has to be cleared as it opens up again
+        if (leaves_[leaf] == FULL)
+        {
+            if (middles_[middle] == FULL)
+            {
+                tops_[top] &= ~(std::uint64_t{ 1U } << (middle % WORD_BITS));
+            }
+
+            middles_[middle] &= ~(std::uint64_t{ 1U } << (leaf % WORD_BITS));
+        }
+
+        leaves_[leaf] &= ~(std::uint64_t{ 1U } << (index % WORD_BITS));
+
+        --size_;
+        firstOpenTop_ = std::min(firstOpenTop_, top);
+    }
+
+
+    template <std::size_t CAPACITY>
+    IntrusiveStack<CAPACITY>::IntrusiveStack(std::byte* slots, std::size_t slotSize) noexcept
+        : slots_{ slots }
+        , slotSize_{ slotSize }
+        , head_{ CAPACITY }
+        , highWater_{ 0U }
+        , size_{ 0U }
+        , mutex_{}
+    { }
+
+    template <std::size_t CAPACITY>
+    bool IntrusiveStack<CAPACITY>::acquire(std::size_t& index) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        return acquireLocked(index);
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t IntrusiveStack<CAPACITY>::acquire(std::span<std::size_t> indices) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        std::size_t count{ 0U };
+
+        while (count != indices.size() && acquireLocked(indices[count]))
+        {
+            ++count;
+        }
+
+        return count;
+    }
+
+    template <std::size_t CAPACITY>
+    void IntrusiveStack<CAPACITY>::release(std::size_t index) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        releaseLocked(index);
+    }
+
+    template <std::size_t CAPACITY>
+    void IntrusiveStack<CAPACITY>::release(std::span<const std::size_t> indices) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        for (const std::size_t index : indices)
+        {
+            releaseLocked(index);
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    std::size_t IntrusiveStack<CAPACITY>::size() const noexcept
+    {
+        return size_;
+    }
+
+    template <std::size_t CAPACITY>
+    bool IntrusiveStack<CAPACITY>::acquireLocked(std::size_t& index) noexcept
+    {
+        if (head_ != CAPACITY)
+        {
+            Link next;
+            std::memcpy(&next, slots_ + head_ * slotSize_, sizeof(Link));
+
+            index = head_;
+            head_ = next;
+        }
+        else if (highWater_ != CAPACITY)
+        {
+            index = highWater_;
+            ++highWater_;
+        }
+        else [[unlikely]]
+        {
+            return false;
+        }
+
+        ++size_;
+
+        return true;
+    }
+
+    template <std::size_t CAPACITY>
+    void IntrusiveStack<CAPACITY>::releaseLocked(std::size_t index) noexcept
+    {
+        const Link next{ static_cast<Link>(head_) };
+        std::memcpy(slots_ + index * slotSize_, &next, sizeof(Link));
+
+        head_ = index;
+        --size_;
+    }
+}
+
+
+#endif // !STACKFULL_OBJECT_POOL_FREE_LISTS
@@ -0,0 +1,140 @@
+﻿#ifndef STACKFULL_OBJECT_POOL_LIVE_MAPS
+#define STACKFULL_OBJECT_POOL_LIVE_MAPS
+
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+
+
+namespace sop
+{
+    // Runs task(0) to task(count - 1), possibly in parallel, and returns once all of them have -
+    // e.g. a thread pool's parallel for, or std::for_each with std::execution::par over the indices.
+    // The workers should outlive the call, so a per-frame visit doesn't pay for starting threads.
+    // The task is type-erased, so an executor can be an ordinary function rather than a template.
+    using BulkTask = std::function<void(std::size_t)>;
+
+    template <typename Executor>
+    concept BulkExecutor = std::invocable<Executor&, std::size_t, const BulkTask&>;
+
+
+    // A live map tracks which of the pool's slots hold live objects, so the pool can visit them.
+    // mark() is called once a slot's object is constructed, unmark() once it's released, and
+    // forEach(firstWord, lastWord, fn) calls fn(index) for the live slots of words [firstWord, lastWord)
+    // of WORDS, lowest index first. A map may also offer forEachRun(firstWord, lastWord, fn), which calls
+    // fn(first, last) for every maximal run [first, last) of live slots instead.
+
+
+    // One bit per slot packed into 64 bit words, set and cleared with fetch_or and fetch_and, so it's
+    // lock-free and a scan reads CAPACITY / 8 bytes sequentially, skipping 64 open slots per empty word.
+    template <std::size_t CAPACITY>
+    class LiveBitmap
+    {
+    public:
+        static constexpr std::size_t WORD_BITS{ 64U };
+        static constexpr std::size_t WORDS{ (CAPACITY + WORD_BITS - 1U) / WORD_BITS };
+
+        LiveBitmap() noexcept;
+
+        void mark(std::size_t index) noexcept;
+
+        void unmark(std::size_t index) noexcept;
+
+        template <typename Fn>
+        void forEach(std::size_t firstWord, std::size_t lastWord, Fn& fn) const noexcept(noexcept(fn(std::size_t{})));
+
+        template <typename Fn>
+        void forEachRun(std::size_t firstWord, std::size_t lastWord, Fn& fn) const noexcept(noexcept(fn(std::size_t{}, std::size_t{})));
+
+    private:
+        std::array<std::atomic<std::uint64_t>, WORDS> words_;
+    };
+
+
+    template <std::size_t CAPACITY>
+    LiveBitmap<CAPACITY>::LiveBitmap() noexcept
+        : words_{}
+    { }
+
+    template <std::size_t CAPACITY>
+    void LiveBitmap<CAPACITY>::mark(std::size_t index) noexcept
+    {
+        // publishes the freshly constructed object to the scans which find its bit set
+        words_[index / WORD_BITS].fetch_or(std::uint64_t{ 1U } << (index % WORD_BITS), std::memory_order_release);
+    }
+
+    template <std::size_t CAPACITY>
+    void LiveBitmap<CAPACITY>::unmark(std::size_t index) noexcept
+    {
+        words_[index / WORD_BITS].fetch_and(~(std::uint64_t{ 1U } << (index % WORD_BITS)), std::memory_order_relaxed);
+    }
+
+    template <std::size_t CAPACITY>
+    template <typename Fn>
+    void LiveBitmap<CAPACITY>::forEach(std::size_t firstWord, std::size_t lastWord, Fn& fn) const noexcept(noexcept(fn(std::size_t{})))
+    {
+        for (std::size_t word{ firstWord }; word != lastWord; ++word)
+        {
+            for (std::uint64_t bits{ words_[word].load(std::memory_order_acquire) }; bits != 0U; bits &= bits - 1U)
+            {
+                fn(word * WORD_BITS + static_cast<std::size_t>(std::countr_zero(bits)));
+            }
+        }
+    }
+
+    template <std::size_t CAPACITY>
+    template <typename Fn>
+    void LiveBitmap<CAPACITY>::forEachRun(std::size_t firstWord, std::size_t lastWord, Fn& fn) const noexcept(noexcept(fn(std::size_t{}, std::size_t{})))
+    {
+        // runs carry on across words, so a densely packed range is handed out whole
+        bool inRun{ false };
+        std::size_t runFirst{ 0U };
+
+        for (std::size_t word{ firstWord }; word != lastWord; ++word)
+        {
+            const std::uint64_t bits{ words_[word].load(std::memory_order_acquire) };
+            std::size_t bit{ 0U };
+
+            while (bit != WORD_BITS)
+            {
+                const std::uint64_t rest{ bits >> bit };
+
+                if (inRun)
+                {
+                    bit += static_cast<std::size_t>(std::countr_one(rest));
+
+                    if (bit != WORD_BITS)
+                    {
+                        fn(runFirst, word * WORD_BITS + bit);
+                        inRun = false;
+                    }
+                }
+                else
+                {
+                    if (rest == 0U)
+                    {
+                        break;
+                    }
+
+                    bit += static_cast<std::size_t>(std::countr_zero(rest));
+                    runFirst = word * WORD_BITS + bit;
+                    inRun = true;
+                }
+            }
+        }
+
+        // the bits past CAPACITY are never set, so a run reaching the last word's end stays within CAPACITY
+        if (inRun)
+        {
+            fn(runFirst, lastWord * WORD_BITS);
+        }
+    }
+}
+
+
+#endif // !STACKFULL_OBJECT_POOL_LIVE_MAPS
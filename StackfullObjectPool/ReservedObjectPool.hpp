@@ -0,0 +1,314 @@
+﻿#ifndef RESERVED_OBJECT_POOL
+#define RESERVED_OBJECT_POOL
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "StackfullObjectPool.hpp"
+
+
+#ifdef SOP_HAS_MMAP
+namespace sop
+{
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits = IntrusivePoolTraits>
+    class ReservedObjectPool;
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits = IntrusivePoolTraits>
+    class ReservedPoolItemDeleter
+    {
+    public:
+        ReservedPoolItemDeleter(ReservedObjectPool<T, MAX_CAPACITY, Traits>& objectPool)
+            : objectPool_{ &objectPool }
+        { }
+
+        void operator()(T* obj) const
+        {
+            // NOTE: The pool's lifetime must exceed that of its objects,
+            // otherwise it'll lead to undefined behavior
+
+            objectPool_->release(obj);
+        }
+
+    private:
+        ReservedObjectPool<T, MAX_CAPACITY, Traits>* objectPool_;
+    };
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits = IntrusivePoolTraits>
+    using ReservedPoolItem = std::unique_ptr<T, const ReservedPoolItemDeleter<T, MAX_CAPACITY, Traits>&>;
+
+
+    // A pool which reserves address space for MAX_CAPACITY slots up front (PROT_NONE) and commits it as the pool grows,
+    // a COMMIT_GRANULE at a time, so it only takes memory for the slots it has handed out so far.
+    // The slots stay a single contiguous range, so objects keep their addresses and release() is a single subtraction.
+    // Slots are committed in the order they're handed out, which suits free lists that hand out the lowest
+    // untouched slot first and keep no per-slot bookkeeping of their own - IntrusiveStack, the default here.
+    // Traits::Storage is ignored.
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    class ReservedObjectPool
+    {
+    public:
+        using FreeList = typename Traits::template FreeList<MAX_CAPACITY>;
+        using Layout = SlotLayout<T, Traits>;
+
+        static_assert(FITS_FREE_LIST<FreeList, Layout::SIZE>, "T is too small to hold the free list's links, pick another FreeList.");
+
+        static constexpr std::size_t COMMIT_GRANULE{ 1U << 16U };
+
+        ReservedObjectPool() noexcept(false);
+
+        ReservedObjectPool(const ReservedObjectPool&) = delete;
+        ReservedObjectPool& operator=(const ReservedObjectPool&) = delete;
+
+        ~ReservedObjectPool();
+
+        // fails with std::bad_alloc if the OS refuses to commit more of the range
+        template <typename... Args>
+        [[nodiscard]] ReservedPoolItem<T, MAX_CAPACITY, Traits> request(Args&&... args) noexcept(false);
+
+        // as request(), but an exhausted pool, or one the OS refuses to commit more of the range to,
+        // returns an empty optional rather than going through Traits::ErrorPolicy
+        template <typename... Args>
+        [[nodiscard]] std::optional<ReservedPoolItem<T, MAX_CAPACITY, Traits>> tryRequest(Args&&... args) noexcept(false);
+
+        [[nodiscard]] consteval std::size_t capacity() const noexcept;
+
+        // the slots backed by committed memory
+        [[nodiscard]] std::size_t committedCapacity() const noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        [[nodiscard]] bool isFull() const noexcept;
+
+    private:
+        friend class ReservedPoolItemDeleter<T, MAX_CAPACITY, Traits>;
+
+        static constexpr std::size_t RESERVED_SIZE{ Layout::SIZE * MAX_CAPACITY };
+        // mmap only aligns the reserved range to a page, and pages are at least this large
+        static constexpr std::size_t MIN_PAGE_SIZE{ 4096U };
+
+        static_assert(Layout::ALIGNMENT <= MIN_PAGE_SIZE, "The slots are aligned beyond a page.");
+
+        std::byte* const pool_;
+        // indices acquired from the free list whose memory could not be committed, guarded by commitMutex_;
+        // they never go back through the free list before their slot is writable, since it links through slot memory
+        std::vector<std::size_t> parked_;
+        std::atomic<std::size_t> parkedCount_;
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> committedSlots_;
+        // guarded by commitMutex_
+        std::size_t committedSize_;
+        std::mutex commitMutex_;
+        alignas(CACHE_LINE_SIZE) FreeList freeList_;
+        const ReservedPoolItemDeleter<T, MAX_CAPACITY, Traits> poolItemDeleter_;
+
+        [[nodiscard]] static std::byte* reserve() noexcept(false);
+
+        // parks idx when the OS refuses the memory, and hands back the parked indices a successful commit covers
+        [[nodiscard]] bool commit(std::size_t idx) noexcept(false);
+
+        [[nodiscard]] bool tryUnpark(std::size_t& idx) noexcept;
+
+        // nullptr once the pool is exhausted, or when the OS refuses to commit the slot's memory, which sets outOfMemory
+        template <typename... Args>
+        [[nodiscard]] T* tryConstruct(bool& outOfMemory, Args&&... args) noexcept(false);
+
+        void release(T* obj) noexcept;
+    };
+
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    ReservedObjectPool<T, MAX_CAPACITY, Traits>::ReservedObjectPool() noexcept(false)
+        : pool_{ reserve() }
+        , parked_{}
+        , parkedCount_{ 0U }
+        , committedSlots_{ 0U }
+        , committedSize_{ 0U }
+        , commitMutex_{}
+        , freeList_{ makeFreeList<FreeList, Layout::SIZE>(pool_) }
+        , poolItemDeleter_{ *this }
+    { }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    ReservedObjectPool<T, MAX_CAPACITY, Traits>::~ReservedObjectPool()
+    {
+        ::munmap(pool_, RESERVED_SIZE);
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    std::byte* ReservedObjectPool<T, MAX_CAPACITY, Traits>::reserve() noexcept(false)
+    {
+        void* const region{ ::mmap(nullptr, RESERVED_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0) };
+
+        if (region == MAP_FAILED) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<std::bad_alloc>();
+        }
+
+        return static_cast<std::byte*>(region);
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    template <typename... Args>
+    ReservedPoolItem<T, MAX_CAPACITY, Traits> ReservedObjectPool<T, MAX_CAPACITY, Traits>::request(Args&&... args) noexcept(false)
+    {
+        bool outOfMemory{ false };
+        T* const obj{ tryConstruct(outOfMemory, std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
+        {
+            if (outOfMemory)
+            {
+                Traits::ErrorPolicy::template fail<std::bad_alloc>();
+            }
+
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
+        }
+
+        return { obj, poolItemDeleter_ };
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    template <typename... Args>
+    std::optional<ReservedPoolItem<T, MAX_CAPACITY, Traits>> ReservedObjectPool<T, MAX_CAPACITY, Traits>::tryRequest(Args&&... args) noexcept(false)
+    {
+        bool outOfMemory{ false };
+        T* const obj{ tryConstruct(outOfMemory, std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
+        {
+            return std::nullopt;
+        }
+
+        return std::optional<ReservedPoolItem<T, MAX_CAPACITY, Traits>>{ std::in_place, obj, poolItemDeleter_ };
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    template <typename... Args>
+    T* ReservedObjectPool<T, MAX_CAPACITY, Traits>::tryConstruct(bool& outOfMemory, Args&&... args) noexcept(false)
+    {
+        std::size_t idx;
+
+        if (!freeList_.acquire(idx) && !tryUnpark(idx)) [[unlikely]]
+        {
+            return nullptr;
+        }
+
+        if (idx >= committedSlots_.load(std::memory_order_acquire) && !commit(idx)) [[unlikely]]
+        {
+            outOfMemory = true;
+
+            return nullptr;
+        }
+
+        return constructAt<T>(pool_ + idx * Layout::SIZE, std::forward<Args>(args)...);
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    bool ReservedObjectPool<T, MAX_CAPACITY, Traits>::commit(std::size_t idx) noexcept(false)
+    {
+        static const std::size_t granule{ std::max(COMMIT_GRANULE, static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))) };
+
+        std::lock_guard lock{ commitMutex_ };
+
+        const std::size_t needed{ (idx + 1U) * Layout::SIZE };
+
+        if (needed <= committedSize_)
+        {
+            return true;
+        }
+
+        const std::size_t size{ std::min((needed + granule - 1U) / granule * granule, RESERVED_SIZE) };
+
+        if (::mprotect(pool_ + committedSize_, size - committedSize_, PROT_READ | PROT_WRITE) != 0) [[unlikely]]
+        {
+            parked_.push_back(idx);
+            parkedCount_.fetch_add(1U, std::memory_order_relaxed);
+
+            return false;
+        }
+
+        committedSize_ = size;
+        committedSlots_.store(size / Layout::SIZE, std::memory_order_release);
+
+        const auto covered{ std::partition(parked_.begin(), parked_.end(), [&](std::size_t parkedIdx) { return parkedIdx * Layout::SIZE >= size; }) };
+
+        for (auto it{ covered }; it != parked_.end(); ++it)
+        {
+            parkedCount_.fetch_sub(1U, std::memory_order_relaxed);
+            freeList_.release(*it);
+        }
+
+        parked_.erase(covered, parked_.end());
+
+        return true;
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    bool ReservedObjectPool<T, MAX_CAPACITY, Traits>::tryUnpark(std::size_t& idx) noexcept
+    {
+        if (parkedCount_.load(std::memory_order_relaxed) == 0U)
+        {
+            return false;
+        }
+
+        std::lock_guard lock{ commitMutex_ };
+
+        if (parked_.empty())
+        {
+            return false;
+        }
+
+        idx = parked_.back();
+        parked_.pop_back();
+        parkedCount_.fetch_sub(1U, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    void ReservedObjectPool<T, MAX_CAPACITY, Traits>::release(T* obj) noexcept
+    {
+        const std::size_t freedObjIdx{ static_cast<std::size_t>(reinterpret_cast<std::byte*>(obj) - pool_) / Layout::SIZE };
+
+        freeList_.release(freedObjIdx);
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    consteval std::size_t ReservedObjectPool<T, MAX_CAPACITY, Traits>::capacity() const noexcept
+    {
+        return MAX_CAPACITY;
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    std::size_t ReservedObjectPool<T, MAX_CAPACITY, Traits>::committedCapacity() const noexcept
+    {
+        return committedSlots_.load(std::memory_order_acquire);
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    std::size_t ReservedObjectPool<T, MAX_CAPACITY, Traits>::size() const noexcept
+    {
+        // parked indices count as acquired by the free list but hold no object; read them first so the difference only over-reports
+        const std::size_t parked{ parkedCount_.load(std::memory_order_acquire) };
+        const std::size_t acquired{ freeList_.size() };
+
+        return acquired > parked ? acquired - parked : 0U;
+    }
+
+    template <PoolItemConcept T, std::size_t MAX_CAPACITY, typename Traits>
+    bool ReservedObjectPool<T, MAX_CAPACITY, Traits>::isFull() const noexcept
+    {
+        return size() == MAX_CAPACITY;
+    }
+}
+#endif
+
+
+#endif // !RESERVED_OBJECT_POOL
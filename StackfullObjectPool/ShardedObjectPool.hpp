@@ -0,0 +1,218 @@
+﻿#ifndef SHARDED_OBJECT_POOL
+#define SHARDED_OBJECT_POOL
+
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+#include "StackfullObjectPool.hpp"
+
+
+namespace sop
+{
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits = DefaultPoolTraits>
+    class ShardedObjectPool;
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits = DefaultPoolTraits>
+    class ShardedPoolItemDeleter
+    {
+    public:
+        ShardedPoolItemDeleter(ShardedObjectPool<T, CAPACITY, SHARDS, Traits>& objectPool)
+            : objectPool_{ &objectPool }
+        { }
+
+        void operator()(T* obj) const
+        {
+            // NOTE: The pool's lifetime must exceed that of its objects,
+            // otherwise it'll lead to undefined behavior
+
+            objectPool_->release(obj);
+        }
+
+    private:
+        ShardedObjectPool<T, CAPACITY, SHARDS, Traits>* objectPool_;
+    };
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits = DefaultPoolTraits>
+    using ShardedPoolItem = std::unique_ptr<T, const ShardedPoolItemDeleter<T, CAPACITY, SHARDS, Traits>&>;
+
+
+    // CAPACITY slots split evenly across SHARDS sub-pools, each with its own free list (Traits::FreeList).
+    // Every thread is assigned a home shard round-robin on its first request, and a request which finds
+    // its home shard empty steals from the other shards, so a request only fails (max_capacity_exception)
+    // once every shard was found empty.
+    // The slots of all shards live in one array, so release() finds the owning shard by dividing the slot's index.
+    // Traits::Storage decides where that array and the shards' free lists live, as in StackfullObjectPool.
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    class ShardedObjectPool
+    {
+        static_assert(SHARDS != 0U && CAPACITY % SHARDS == 0U, "CAPACITY must split evenly across SHARDS.");
+
+    public:
+        static constexpr std::size_t SHARD_CAPACITY{ CAPACITY / SHARDS };
+
+        using FreeList = typename Traits::template FreeList<SHARD_CAPACITY>;
+        using Layout = SlotLayout<T, Traits>;
+
+        static_assert(FITS_FREE_LIST<FreeList, Layout::SIZE>, "T is too small to hold the free list's links, pick another FreeList.");
+
+        ShardedObjectPool() noexcept(std::is_nothrow_constructible_v<Storage, ShardedObjectPool&>);
+
+        template <typename... Args>
+        [[nodiscard]] ShardedPoolItem<T, CAPACITY, SHARDS, Traits> request(Args&&... args) noexcept(false);
+
+        // as request(), but an exhausted pool returns an empty optional rather than going through Traits::ErrorPolicy
+        template <typename... Args>
+        [[nodiscard]] std::optional<ShardedPoolItem<T, CAPACITY, SHARDS, Traits>> tryRequest(Args&&... args) noexcept(false);
+
+        [[nodiscard]] consteval std::size_t capacity() const noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        [[nodiscard]] bool isFull() const noexcept;
+
+    private:
+        friend class ShardedPoolItemDeleter<T, CAPACITY, SHARDS, Traits>;
+
+        // keeps neighbouring shards' free lists off each other's cache lines
+        struct alignas(CACHE_LINE_SIZE) Shard
+        {
+            FreeList freeList;
+        };
+
+        struct Slab
+        {
+            explicit Slab(ShardedObjectPool& objectPool) noexcept
+                : Slab{ objectPool, std::make_index_sequence<SHARDS>{} }
+            { }
+
+            template <std::size_t... SHARD>
+            Slab(ShardedObjectPool& objectPool, std::index_sequence<SHARD...>) noexcept
+                : pool{}
+                , shards{ Shard{ makeFreeList<FreeList, Layout::SIZE>(&pool[SHARD * SHARD_CAPACITY * Layout::SIZE]) }... }
+                , poolItemDeleter{ objectPool }
+            { }
+
+            alignas(Layout::ALIGNMENT) std::array<std::byte, Layout::SIZE * CAPACITY> pool;
+            std::array<Shard, SHARDS> shards;
+            const ShardedPoolItemDeleter<T, CAPACITY, SHARDS, Traits> poolItemDeleter;
+        };
+
+        using Storage = typename Traits::template Storage<Slab>;
+
+        Storage storage_;
+
+        [[nodiscard]] static std::size_t homeShard() noexcept;
+
+        // nullptr once every shard is exhausted
+        template <typename... Args>
+        [[nodiscard]] T* tryConstruct(Args&&... args) noexcept(false);
+
+        void release(T* obj) noexcept;
+    };
+
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    ShardedObjectPool<T, CAPACITY, SHARDS, Traits>::ShardedObjectPool() noexcept(std::is_nothrow_constructible_v<Storage, ShardedObjectPool&>)
+        : storage_{ *this }
+    { }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    template <typename... Args>
+    ShardedPoolItem<T, CAPACITY, SHARDS, Traits> ShardedObjectPool<T, CAPACITY, SHARDS, Traits>::request(Args&&... args) noexcept(false)
+    {
+        T* const obj{ tryConstruct(std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
+        }
+
+        return { obj, storage_->poolItemDeleter };
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    template <typename... Args>
+    std::optional<ShardedPoolItem<T, CAPACITY, SHARDS, Traits>> ShardedObjectPool<T, CAPACITY, SHARDS, Traits>::tryRequest(Args&&... args) noexcept(false)
+    {
+        T* const obj{ tryConstruct(std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
+        {
+            return std::nullopt;
+        }
+
+        return std::optional<ShardedPoolItem<T, CAPACITY, SHARDS, Traits>>{ std::in_place, obj, storage_->poolItemDeleter };
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    template <typename... Args>
+    T* ShardedObjectPool<T, CAPACITY, SHARDS, Traits>::tryConstruct(Args&&... args) noexcept(false)
+    {
+        const std::size_t home{ homeShard() };
+
+        for (std::size_t i{ 0U }; i != SHARDS; ++i)
+        {
+            const std::size_t shard{ (home + i) % SHARDS };
+            std::size_t idx;
+
+            if (storage_->shards[shard].freeList.acquire(idx)) [[likely]]
+            {
+                idx += shard * SHARD_CAPACITY;
+
+                return constructAt<T>(&storage_->pool[idx * Layout::SIZE], std::forward<Args>(args)...);
+            }
+        }
+
+        return nullptr;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    void ShardedObjectPool<T, CAPACITY, SHARDS, Traits>::release(T* obj) noexcept
+    {
+        const std::size_t freedObjIdx{ static_cast<std::size_t>(reinterpret_cast<std::byte*>(obj) - storage_->pool.data()) / Layout::SIZE };
+
+        storage_->shards[freedObjIdx / SHARD_CAPACITY].freeList.release(freedObjIdx % SHARD_CAPACITY);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    std::size_t ShardedObjectPool<T, CAPACITY, SHARDS, Traits>::homeShard() noexcept
+    {
+        static std::atomic<std::size_t> nextHome{ 0U };
+        thread_local const std::size_t home{ nextHome.fetch_add(1U, std::memory_order_relaxed) % SHARDS };
+
+        return home;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    consteval std::size_t ShardedObjectPool<T, CAPACITY, SHARDS, Traits>::capacity() const noexcept
+    {
+        return CAPACITY;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    std::size_t ShardedObjectPool<T, CAPACITY, SHARDS, Traits>::size() const noexcept
+    {
+        std::size_t size{ 0U };
+
+        for (const Shard& shard : storage_->shards)
+        {
+            size += shard.freeList.size();
+        }
+
+        return size;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, std::size_t SHARDS, typename Traits>
+    bool ShardedObjectPool<T, CAPACITY, SHARDS, Traits>::isFull() const noexcept
+    {
+        return size() == CAPACITY;
+    }
+}
+
+
+#endif // !SHARDED_OBJECT_POOL
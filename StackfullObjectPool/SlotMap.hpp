@@ -0,0 +1,385 @@
+﻿#ifndef SLOT_MAP
+#define SLOT_MAP
+
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "StackfullObjectPool.hpp"
+
+
+namespace sop
+{
+    // A reference to an object of a SlotMap - the index of its slot together with the slot's generation when the
+    // object was requested. Handles are plain values, so they may be copied and stored freely, and outliving their
+    // object just makes them stale rather than dangling. A default constructed handle refers to nothing.
+    // The index takes the low bits, as few as CAPACITY needs, and the generation all the others of a 32 bit value
+    // (pools of up to 2^16 slots) or a 64 bit one. A slot's generation wraps around after 2^(GENERATION_BITS - 1)
+    // requests, so a handle kept across that many reuses of its slot aliases the slot's object again.
+    template <std::size_t CAPACITY>
+    class SlotHandle
+    {
+    public:
+        using Value = std::conditional_t<(CAPACITY <= (std::size_t{ 1U } << 16U)), std::uint32_t, std::uint64_t>;
+
+        static constexpr std::size_t INDEX_BITS{ static_cast<std::size_t>(std::bit_width(CAPACITY - 1U)) };
+        static constexpr std::size_t GENERATION_BITS{ std::numeric_limits<Value>::digits - INDEX_BITS };
+        static constexpr Value GENERATION_MASK{ std::numeric_limits<Value>::max() >> INDEX_BITS };
+
+        static_assert(CAPACITY != 0U && GENERATION_BITS >= 8U, "CAPACITY leaves too few bits for the generation.");
+
+        constexpr SlotHandle() noexcept = default;
+
+        constexpr SlotHandle(std::size_t index, Value generation) noexcept;
+
+        // a handle from its value(), e.g. one that was stored or sent elsewhere
+        [[nodiscard]] static constexpr SlotHandle fromValue(Value value) noexcept;
+
+        [[nodiscard]] constexpr Value value() const noexcept;
+
+        [[nodiscard]] constexpr std::size_t index() const noexcept;
+
+        [[nodiscard]] constexpr Value generation() const noexcept;
+
+        [[nodiscard]] friend constexpr bool operator==(SlotHandle lhs, SlotHandle rhs) noexcept = default;
+
+    private:
+        Value value_{ 0U };
+    };
+
+
+    // StackfullObjectPool's sibling which hands out SlotHandles instead of PoolItems. Objects live until
+    // release(handle), at fixed addresses as in the other pools, and get(handle) returns nullptr in O(1) once
+    // the handle is stale - its object was released, and perhaps its slot reused - rather than aliasing the
+    // slot's next object. The indices of the live objects are kept densely packed, so forEach() visits just
+    // the live objects, in no particular order.
+    // Every slot keeps a generation, odd while the slot is in use, and bumped on every request and release.
+    // The free slots are linked through their bookkeeping, so Traits::FreeList is ignored, and unlike the
+    // other pools a SlotMap isn't thread safe - as with the standard containers, calls that may change it
+    // must not overlap with any other calls.
+    // Traits::Storage decides where the slots and their bookkeeping live, as in StackfullObjectPool.
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits = DefaultPoolTraits>
+    class SlotMap
+    {
+    public:
+        using Handle = SlotHandle<CAPACITY>;
+        using Layout = SlotLayout<T, Traits>;
+
+        SlotMap() noexcept(std::is_nothrow_constructible_v<Storage>);
+
+        template <typename... Args>
+        [[nodiscard]] Handle request(Args&&... args) noexcept(false);
+
+        // as request(), but an exhausted pool returns an empty optional rather than going through Traits::ErrorPolicy
+        template <typename... Args>
+        [[nodiscard]] std::optional<Handle> tryRequest(Args&&... args) noexcept(false);
+
+        // hands handle's slot back, false if handle was already stale
+        bool release(Handle handle) noexcept;
+
+        // the object handle refers to, nullptr once handle is stale
+        [[nodiscard]] T* get(Handle handle) noexcept;
+
+        [[nodiscard]] const T* get(Handle handle) const noexcept;
+
+        [[nodiscard]] bool contains(Handle handle) const noexcept;
+
+        // the handle of a live object of the pool
+        [[nodiscard]] Handle handleOf(const T& obj) const noexcept;
+
+        // calls fn(obj) or fn(handle, obj) for every live object, which fn mustn't request nor release
+        template <typename Fn>
+        void forEach(Fn&& fn) noexcept(false);
+
+        template <typename Fn>
+        void forEach(Fn&& fn) const noexcept(false);
+
+        [[nodiscard]] consteval std::size_t capacity() const noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        [[nodiscard]] bool isFull() const noexcept;
+
+    private:
+        using Index = IndexFor<CAPACITY>;
+        using Generation = typename Handle::Value;
+
+        // no free slot to link to
+        static constexpr std::size_t NO_SLOT{ CAPACITY };
+
+        struct SlotState
+        {
+            // odd while the slot holds a live object
+            Generation generation;
+            // the live object's position in dense, or the next free slot while the slot is free
+            UintFor<CAPACITY> link;
+        };
+
+        struct Slab
+        {
+            Slab() noexcept
+                : pool{}
+                , states{}
+                , dense{}
+                , size{ 0U }
+                , freeHead{ NO_SLOT }
+                , untouched{ 0U }
+            { }
+
+            alignas(Layout::ALIGNMENT) std::array<std::byte, Layout::SIZE * CAPACITY> pool;
+            // the bookkeeping starts on a line of its own, away from the last objects in pool
+            alignas(CACHE_LINE_SIZE) std::array<SlotState, CAPACITY> states;
+            // the slots of the live objects, in dense[0, size)
+            std::array<Index, CAPACITY> dense;
+            std::size_t size;
+            // the most recently released slot
+            std::size_t freeHead;
+            // slots from here on were never handed out, so they aren't linked yet
+            std::size_t untouched;
+        };
+
+        using Storage = typename Traits::template Storage<Slab>;
+
+        Storage storage_;
+
+        // empty once the pool is exhausted
+        template <typename... Args>
+        [[nodiscard]] std::optional<Handle> tryConstruct(Args&&... args) noexcept(false);
+
+        // the object in slot idx, which must be live
+        [[nodiscard]] T* slot(std::size_t idx) noexcept;
+
+        [[nodiscard]] const T* slot(std::size_t idx) const noexcept;
+
+        template <typename Self, typename Fn>
+        static void forEachIn(Self& self, Fn& fn);
+    };
+
+
+    template <std::size_t CAPACITY>
+    constexpr SlotHandle<CAPACITY>::SlotHandle(std::size_t index, Value generation) noexcept
+        : value_{ static_cast<Value>((static_cast<Value>(generation) << INDEX_BITS) | index) }
+    { }
+
+    template <std::size_t CAPACITY>
+    constexpr SlotHandle<CAPACITY> SlotHandle<CAPACITY>::fromValue(Value value) noexcept
+    {
+        SlotHandle handle{};
+        handle.value_ = value;
+
+        return handle;
+    }
+
+    template <std::size_t CAPACITY>
+    constexpr typename SlotHandle<CAPACITY>::Value SlotHandle<CAPACITY>::value() const noexcept
+    {
+        return value_;
+    }
+
+    template <std::size_t CAPACITY>
+    constexpr std::size_t SlotHandle<CAPACITY>::index() const noexcept
+    {
+        return static_cast<std::size_t>(value_ & ~(GENERATION_MASK << INDEX_BITS));
+    }
+
+    template <std::size_t CAPACITY>
+    constexpr typename SlotHandle<CAPACITY>::Value SlotHandle<CAPACITY>::generation() const noexcept
+    {
+        return static_cast<Value>(value_ >> INDEX_BITS);
+    }
+
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    SlotMap<T, CAPACITY, Traits>::SlotMap() noexcept(std::is_nothrow_constructible_v<Storage>)
+        : storage_{}
+    { }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename... Args>
+    typename SlotMap<T, CAPACITY, Traits>::Handle SlotMap<T, CAPACITY, Traits>::request(Args&&... args) noexcept(false)
+    {
+        const std::optional<Handle> handle{ tryConstruct(std::forward<Args>(args)...) };
+
+        if (!handle) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
+        }
+
+        return *handle;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename... Args>
+    std::optional<typename SlotMap<T, CAPACITY, Traits>::Handle> SlotMap<T, CAPACITY, Traits>::tryRequest(Args&&... args) noexcept(false)
+    {
+        return tryConstruct(std::forward<Args>(args)...);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename... Args>
+    std::optional<typename SlotMap<T, CAPACITY, Traits>::Handle> SlotMap<T, CAPACITY, Traits>::tryConstruct(Args&&... args) noexcept(false)
+    {
+        std::size_t idx;
+
+        if (storage_->freeHead != NO_SLOT)
+        {
+            idx = storage_->freeHead;
+        }
+        else if (storage_->untouched != CAPACITY) [[likely]]
+        {
+            idx = storage_->untouched;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+
+        // construct first, so a throwing constructor leaves the pool as it was - into the raw storage,
+        // since slot() launders a pointer to an object which doesn't exist yet
+        static_cast<void>(constructAt<T>(&storage_->pool[idx * Layout::SIZE], std::forward<Args>(args)...));
+
+        SlotState& state{ storage_->states[idx] };
+
+        if (idx == storage_->freeHead)
+        {
+            storage_->freeHead = state.link;
+        }
+        else
+        {
+            ++storage_->untouched;
+        }
+
+        state.generation = static_cast<Generation>((state.generation + 1U) & Handle::GENERATION_MASK);
+        state.link = static_cast<UintFor<CAPACITY>>(storage_->size);
+        storage_->dense[storage_->size++] = static_cast<Index>(idx);
+
+        return Handle{ idx, state.generation };
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    bool SlotMap<T, CAPACITY, Traits>::release(Handle handle) noexcept
+    {
+        if (!contains(handle)) [[unlikely]]
+        {
+            return false;
+        }
+
+        const std::size_t idx{ handle.index() };
+        SlotState& state{ storage_->states[idx] };
+
+        // the last live object takes the released one's place in dense
+        const Index last{ storage_->dense[--storage_->size] };
+        storage_->dense[state.link] = last;
+        storage_->states[last].link = state.link;
+
+        state.generation = static_cast<Generation>((state.generation + 1U) & Handle::GENERATION_MASK);
+        state.link = static_cast<UintFor<CAPACITY>>(storage_->freeHead);
+        storage_->freeHead = idx;
+
+        return true;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    T* SlotMap<T, CAPACITY, Traits>::get(Handle handle) noexcept
+    {
+        return contains(handle) ? slot(handle.index()) : nullptr;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    const T* SlotMap<T, CAPACITY, Traits>::get(Handle handle) const noexcept
+    {
+        return contains(handle) ? slot(handle.index()) : nullptr;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    bool SlotMap<T, CAPACITY, Traits>::contains(Handle handle) const noexcept
+    {
+        const std::size_t idx{ handle.index() };
+
+        // even generations - those of free slots, and of the default constructed handle - never match a live object
+        return idx < CAPACITY && (handle.generation() & 1U) != 0U && storage_->states[idx].generation == handle.generation();
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    typename SlotMap<T, CAPACITY, Traits>::Handle SlotMap<T, CAPACITY, Traits>::handleOf(const T& obj) const noexcept
+    {
+        const std::size_t idx{ static_cast<std::size_t>(reinterpret_cast<const std::byte*>(&obj) - storage_->pool.data()) / Layout::SIZE };
+
+        return Handle{ idx, storage_->states[idx].generation };
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename Fn>
+    void SlotMap<T, CAPACITY, Traits>::forEach(Fn&& fn) noexcept(false)
+    {
+        forEachIn(*this, fn);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename Fn>
+    void SlotMap<T, CAPACITY, Traits>::forEach(Fn&& fn) const noexcept(false)
+    {
+        forEachIn(*this, fn);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename Self, typename Fn>
+    void SlotMap<T, CAPACITY, Traits>::forEachIn(Self& self, Fn& fn)
+    {
+        using Object = std::conditional_t<std::is_const_v<Self>, const T, T>;
+
+        for (std::size_t i{ 0U }; i != self.storage_->size; ++i)
+        {
+            const std::size_t idx{ self.storage_->dense[i] };
+            Object& obj{ *self.slot(idx) };
+
+            if constexpr (std::is_invocable_v<Fn&, Handle, Object&>)
+            {
+                fn(Handle{ idx, self.storage_->states[idx].generation }, obj);
+            }
+            else
+            {
+                fn(obj);
+            }
+        }
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    T* SlotMap<T, CAPACITY, Traits>::slot(std::size_t idx) noexcept
+    {
+        return std::launder(reinterpret_cast<T*>(&storage_->pool[idx * Layout::SIZE]));
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    const T* SlotMap<T, CAPACITY, Traits>::slot(std::size_t idx) const noexcept
+    {
+        return std::launder(reinterpret_cast<const T*>(&storage_->pool[idx * Layout::SIZE]));
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    consteval std::size_t SlotMap<T, CAPACITY, Traits>::capacity() const noexcept
+    {
+        return CAPACITY;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    std::size_t SlotMap<T, CAPACITY, Traits>::size() const noexcept
+    {
+        return storage_->size;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    bool SlotMap<T, CAPACITY, Traits>::isFull() const noexcept
+    {
+        return storage_->size == CAPACITY;
+    }
+}
+
+
+#endif // !SLOT_MAP
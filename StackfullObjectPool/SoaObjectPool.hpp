@@ -0,0 +1,380 @@
+﻿#ifndef SOA_OBJECT_POOL
+#define SOA_OBJECT_POOL
+
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "StackfullObjectPool.hpp"
+
+
+namespace sop
+{
+    template <typename Fields, std::size_t CAPACITY, typename Traits = DefaultPoolTraits>
+    class SoaObjectPool;
+
+    // The owning handle of a SoaObjectPool's object - the pool together with the object's slot index.
+    // get<FIELD>() reaches the object's fields, and the slot goes back to the pool once the item is destroyed or reset.
+    template <typename Fields, std::size_t CAPACITY, typename Traits = DefaultPoolTraits>
+    class SoaPoolItem;
+
+
+    // StackfullObjectPool's structure-of-arrays sibling. Its objects are records of the Fields of a std::tuple,
+    // e.g. sop::SoaObjectPool<std::tuple<int, float, double>, 1024U>, and every field lives in a column of its own,
+    // a cache line aligned array of CAPACITY values, rather than beside the other fields of its object.
+    // column<FIELD>() exposes a whole column, and forEachLiveRun(fn) hands out the runs of live slots, so a
+    // kernel over a single field - a plain loop over a column's run - reads only that field, contiguously,
+    // and vectorizes. request(fields...) hands out a SoaPoolItem.
+    // Traits::FreeList hands out the slots as in StackfullObjectPool (an IntrusiveStack keeps its links in the
+    // first column), the live slots are always tracked with a LiveBitmap (Traits::LiveMap is ignored), and
+    // Traits::Storage decides where the columns live.
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    class SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>
+    {
+    public:
+        template <std::size_t FIELD>
+        using Field = std::tuple_element_t<FIELD, std::tuple<Fields...>>;
+
+        using FreeList = typename Traits::template FreeList<CAPACITY>;
+        using Item = SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>;
+
+        static_assert(sizeof...(Fields) != 0U, "A SoaObjectPool needs at least one field.");
+        static_assert(FITS_FREE_LIST<FreeList, sizeof(Field<0U>)>, "The first field is too small to hold the free list's links, pick another FreeList.");
+
+        SoaObjectPool() noexcept(std::is_nothrow_constructible_v<Storage>);
+
+        // value-initializes every field, request(sop::DEFAULT_INIT) leaves them alone
+        [[nodiscard]] Item request() noexcept(false);
+
+        [[nodiscard]] Item request(DefaultInit) noexcept(false);
+
+        [[nodiscard]] Item request(const Fields&... fields) noexcept(false);
+
+        // as request(), but an exhausted pool returns an empty optional rather than going through Traits::ErrorPolicy
+        [[nodiscard]] std::optional<Item> tryRequest() noexcept(false);
+
+        [[nodiscard]] std::optional<Item> tryRequest(DefaultInit) noexcept(false);
+
+        [[nodiscard]] std::optional<Item> tryRequest(const Fields&... fields) noexcept(false);
+
+        // every slot's FIELD, live or not - index it with the slots forEachLiveRun() hands out
+        template <std::size_t FIELD>
+        [[nodiscard]] std::span<Field<FIELD>, CAPACITY> column() noexcept;
+
+        template <std::size_t FIELD>
+        [[nodiscard]] std::span<const Field<FIELD>, CAPACITY> column() const noexcept;
+
+        // calls fn(first, last) for every maximal run [first, last) of live slots, lowest first. Objects requested
+        // meanwhile may or may not be covered, and none may be released until it returns.
+        template <typename Fn>
+        void forEachLiveRun(Fn&& fn) const noexcept(false);
+
+        // as forEachLiveRun(fn), but calls fn(slot) for every live slot - cheaper once the live slots are scattered
+        // rather than packed, and the runs get too short for a vectorized loop to pay off
+        template <typename Fn>
+        void forEachLive(Fn&& fn) const noexcept(false);
+
+        // as forEachLiveRun(fn), but only covers the part-th of parts equal ranges of the slots,
+        // so the parts may be processed in parallel - a run may be split at a part's boundaries;
+        // part must be less than parts, otherwise the ErrorPolicy fails with std::out_of_range
+        template <typename Fn>
+        void forEachLiveRun(std::size_t part, std::size_t parts, Fn&& fn) const noexcept(false);
+
+        [[nodiscard]] consteval std::size_t capacity() const noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        [[nodiscard]] bool isFull() const noexcept;
+
+    private:
+        friend Item;
+
+        template <typename Value>
+        struct alignas(CACHE_LINE_SIZE) Column
+        {
+            std::array<Value, CAPACITY> values;
+        };
+
+        struct Slab
+        {
+            Slab() noexcept
+                : columns{}
+                , freeList{ makeFreeList<FreeList, sizeof(Field<0U>)>(reinterpret_cast<std::byte*>(std::get<0U>(columns).values.data())) }
+                , live{}
+            { }
+
+            std::tuple<Column<Fields>...> columns;
+            // the free list's bookkeeping starts on a line of its own, away from the last column
+            alignas(CACHE_LINE_SIZE) FreeList freeList;
+            LiveBitmap<CAPACITY> live;
+        };
+
+        using Storage = typename Traits::template Storage<Slab>;
+
+        Storage storage_;
+
+        // empty once the pool is exhausted, init(idx) constructs the fields of slot idx
+        template <typename Init>
+        [[nodiscard]] std::optional<Item> tryConstruct(const Init& init) noexcept(false);
+
+        void release(std::size_t idx) noexcept;
+    };
+
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    class SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>
+    {
+    public:
+        using Pool = SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>;
+
+        template <std::size_t FIELD>
+        using Field = typename Pool::template Field<FIELD>;
+
+        SoaPoolItem(SoaPoolItem&& other) noexcept;
+
+        SoaPoolItem& operator=(SoaPoolItem&& other) noexcept;
+
+        ~SoaPoolItem();
+
+        // only while the item holds a slot, not once it's been moved from or reset()
+        template <std::size_t FIELD>
+        [[nodiscard]] Field<FIELD>& get() const noexcept;
+
+        // the object's slot, its index within the pool's columns
+        [[nodiscard]] std::size_t index() const noexcept;
+
+        [[nodiscard]] explicit operator bool() const noexcept;
+
+        void reset() noexcept;
+
+    private:
+        friend Pool;
+
+        // NOTE: as with PoolItem, the pool's lifetime must exceed that of its items
+        Pool* objectPool_;
+        std::size_t index_;
+
+        SoaPoolItem(Pool& objectPool, std::size_t index) noexcept;
+    };
+
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::SoaObjectPool() noexcept(std::is_nothrow_constructible_v<Storage>)
+        : storage_{}
+    { }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    auto SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::request() noexcept(false) -> Item
+    {
+        std::optional<Item> item{ tryRequest() };
+
+        if (!item) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
+        }
+
+        return std::move(*item);
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    auto SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::request(DefaultInit) noexcept(false) -> Item
+    {
+        std::optional<Item> item{ tryRequest(DEFAULT_INIT) };
+
+        if (!item) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
+        }
+
+        return std::move(*item);
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    auto SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::request(const Fields&... fields) noexcept(false) -> Item
+    {
+        std::optional<Item> item{ tryRequest(fields...) };
+
+        if (!item) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
+        }
+
+        return std::move(*item);
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    auto SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::tryRequest() noexcept(false) -> std::optional<Item>
+    {
+        return tryConstruct([this](std::size_t idx) {
+            std::apply([idx](auto&... columns) { ((columns.values[idx] = {}), ...); }, storage_->columns);
+        });
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    auto SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::tryRequest(DefaultInit) noexcept(false) -> std::optional<Item>
+    {
+        return tryConstruct([](std::size_t) { });
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    auto SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::tryRequest(const Fields&... fields) noexcept(false) -> std::optional<Item>
+    {
+        return tryConstruct([this, &fields...](std::size_t idx) {
+            std::apply([idx, &fields...](auto&... columns) { ((columns.values[idx] = fields), ...); }, storage_->columns);
+        });
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    template <typename Init>
+    auto SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::tryConstruct(const Init& init) noexcept(false) -> std::optional<Item>
+    {
+        std::size_t idx;
+
+        if (!storage_->freeList.acquire(idx)) [[unlikely]]
+        {
+            return std::nullopt;
+        }
+
+        init(idx);
+        storage_->live.mark(idx);
+
+        return std::optional<Item>{ Item{ *this, idx } };
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    void SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::release(std::size_t idx) noexcept
+    {
+        storage_->live.unmark(idx);
+        storage_->freeList.release(idx);
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    template <std::size_t FIELD>
+    auto SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::column() noexcept -> std::span<Field<FIELD>, CAPACITY>
+    {
+        return std::span<Field<FIELD>, CAPACITY>{ std::get<FIELD>(storage_->columns).values };
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    template <std::size_t FIELD>
+    auto SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::column() const noexcept -> std::span<const Field<FIELD>, CAPACITY>
+    {
+        return std::span<const Field<FIELD>, CAPACITY>{ std::get<FIELD>(storage_->columns).values };
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    template <typename Fn>
+    void SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::forEachLiveRun(Fn&& fn) const noexcept(false)
+    {
+        forEachLiveRun(0U, 1U, fn);
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    template <typename Fn>
+    void SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::forEachLiveRun(std::size_t part, std::size_t parts, Fn&& fn) const noexcept(false)
+    {
+        constexpr std::size_t WORDS{ LiveBitmap<CAPACITY>::WORDS };
+
+        if (part >= parts) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<std::out_of_range>("forEachLiveRun part must be less than parts.");
+        }
+
+        storage_->live.forEachRun(WORDS * part / parts, WORDS * (part + 1U) / parts, fn);
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    template <typename Fn>
+    void SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::forEachLive(Fn&& fn) const noexcept(false)
+    {
+        storage_->live.forEach(0U, LiveBitmap<CAPACITY>::WORDS, fn);
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    consteval std::size_t SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::capacity() const noexcept
+    {
+        return CAPACITY;
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    std::size_t SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::size() const noexcept
+    {
+        return storage_->freeList.size();
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    bool SoaObjectPool<std::tuple<Fields...>, CAPACITY, Traits>::isFull() const noexcept
+    {
+        return storage_->freeList.size() == CAPACITY;
+    }
+
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>::SoaPoolItem(Pool& objectPool, std::size_t index) noexcept
+        : objectPool_{ &objectPool }
+        , index_{ index }
+    { }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>::SoaPoolItem(SoaPoolItem&& other) noexcept
+        : objectPool_{ std::exchange(other.objectPool_, nullptr) }
+        , index_{ other.index_ }
+    { }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>& SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>::operator=(SoaPoolItem&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+
+            objectPool_ = std::exchange(other.objectPool_, nullptr);
+            index_ = other.index_;
+        }
+
+        return *this;
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>::~SoaPoolItem()
+    {
+        reset();
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    template <std::size_t FIELD>
+    auto SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>::get() const noexcept -> Field<FIELD>&
+    {
+        return std::get<FIELD>(objectPool_->storage_->columns).values[index_];
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    std::size_t SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>::index() const noexcept
+    {
+        return index_;
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>::operator bool() const noexcept
+    {
+        return objectPool_ != nullptr;
+    }
+
+    template <PoolItemConcept... Fields, std::size_t CAPACITY, typename Traits>
+    void SoaPoolItem<std::tuple<Fields...>, CAPACITY, Traits>::reset() noexcept
+    {
+        if (objectPool_ != nullptr)
+        {
+            std::exchange(objectPool_, nullptr)->release(index_);
+        }
+    }
+}
+
+
+#endif // !SOA_OBJECT_POOL
@@ -2,9 +2,28 @@
 #define STACKFULL_OBJECT_POOL
 
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
 #include <memory>
-#include <mutex>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ErrorPolicies.hpp"
+#include "FreeLists.hpp"
+#include "LiveMaps.hpp"
+#include "Storages.hpp"
+#include "WaitQueues.hpp"
 
 
 namespace sop
@@ -13,10 +32,214 @@ namespace sop
     concept PoolItemConcept = std::is_trivially_copyable_v<T>;
 
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
+    // The pool's policies. Derive from DefaultPoolTraits and shadow the members you want to change, e.g.
+    // struct MyTraits : sop::DefaultPoolTraits { template <std::size_t CAPACITY> using FreeList = sop::TreiberStack<CAPACITY>; };
+    struct DefaultPoolTraits
+    {
+        template <std::size_t CAPACITY>
+        using FreeList = DefaultFreeList<CAPACITY>;
+
+        // every slot is aligned to the larger of alignof(T) and SLOT_ALIGNMENT,
+        // raise it (e.g. to 32 or 64) for aligned SIMD loads and stores on the pooled objects
+        static constexpr std::size_t SLOT_ALIGNMENT{ 1U };
+
+        // consecutive slots are at least SLOT_STRIDE bytes apart
+        static constexpr std::size_t SLOT_STRIDE{ 1U };
+
+        // where the slots and the free list live
+        template <typename Slab>
+        using Storage = InlineStorage<Slab>;
+
+        // an allocator of T which request() turns to once every slot is handed out (StackfullObjectPool only),
+        // void to throw max_capacity_exception instead
+        template <typename T>
+        using OverflowAllocator = void;
+
+        // what request() does once the pool is exhausted - throws by default, aborts with exceptions disabled
+        using ErrorPolicy = DefaultErrorPolicy;
+
+        // what requestUntil() and requestFor() park on while the pool is full (StackfullObjectPool only),
+        // void for pools which never block, whose releases then don't look for parked requests
+        using WaitQueue = void;
+
+        // what asyncRequest() parks coroutines on while the pool is full (StackfullObjectPool only), void as WaitQueue
+        using AwaitQueue = void;
+
+        // what forEachLive() finds the live objects with (StackfullObjectPool only),
+        // void for pools which don't visit their objects, whose requests and releases then don't track them
+        template <std::size_t CAPACITY>
+        using LiveMap = void;
+    };
+
+    // every slot gets a cache line (or more) of its own, so threads writing to neighbouring objects don't false share
+    struct PaddedPoolTraits : DefaultPoolTraits
+    {
+        static constexpr std::size_t SLOT_ALIGNMENT{ CACHE_LINE_SIZE };
+    };
+
+    struct LockedPoolTraits : DefaultPoolTraits
+    {
+        template <std::size_t CAPACITY>
+        using FreeList = LockedStack<CAPACITY>;
+    };
+
+    struct HierarchicalBitmapPoolTraits : DefaultPoolTraits
+    {
+        template <std::size_t CAPACITY>
+        using FreeList = HierarchicalBitmap<CAPACITY>;
+    };
+
+    struct IntrusivePoolTraits : DefaultPoolTraits
+    {
+        template <std::size_t CAPACITY>
+        using FreeList = IntrusiveStack<CAPACITY>;
+    };
+
+    struct LockFreePoolTraits : DefaultPoolTraits
+    {
+        template <std::size_t CAPACITY>
+        using FreeList = TreiberStack<CAPACITY>;
+    };
+
+    struct MagazinePoolTraits : DefaultPoolTraits
+    {
+        template <std::size_t CAPACITY>
+        using FreeList = MagazineCache<LockedStack<CAPACITY>>;
+    };
+
+    struct RemoteFreePoolTraits : DefaultPoolTraits
+    {
+        template <std::size_t CAPACITY>
+        using FreeList = RemoteFreeList<CAPACITY>;
+    };
+
+    struct PerCpuPoolTraits : DefaultPoolTraits
+    {
+        template <std::size_t CAPACITY>
+        using FreeList = PerCpuLockedCache<LockedStack<CAPACITY>>;
+    };
+
+    struct HeapPoolTraits : DefaultPoolTraits
+    {
+        template <typename Slab>
+        using Storage = HeapStorage<Slab>;
+    };
+
+#ifdef SOP_HAS_MMAP
+    struct MmapPoolTraits : DefaultPoolTraits
+    {
+        template <typename Slab>
+        using Storage = MmapStorage<Slab>;
+    };
+#endif
+
+    struct HeapOverflowPoolTraits : DefaultPoolTraits
+    {
+        template <typename T>
+        using OverflowAllocator = std::allocator<T>;
+    };
+
+    struct BlockingPoolTraits : DefaultPoolTraits
+    {
+        using WaitQueue = sop::ConditionWaitQueue;
+    };
+
+    // lets the pool hand out CompactPoolItems
+    struct CompactPoolTraits : DefaultPoolTraits
+    {
+        template <typename Slab>
+        using Storage = SizeAlignedStorage<Slab>;
+    };
+
+    struct AsyncPoolTraits : DefaultPoolTraits
+    {
+        using AwaitQueue = sop::CoroutineWaitQueue;
+    };
+
+    struct LivePoolTraits : DefaultPoolTraits
+    {
+        template <std::size_t CAPACITY>
+        using LiveMap = LiveBitmap<CAPACITY>;
+    };
+
+
+    // The objects a pool allocated with its OverflowAllocator once it ran full, and how many it allocated so far.
+    template <typename Allocator>
+    struct OverflowHeap
+    {
+        [[no_unique_address]] Allocator allocator;
+        std::atomic<std::size_t> count;
+    };
+
+    template <>
+    struct OverflowHeap<void>
+    { };
+
+
+    // The requests parked on a full pool with a WaitQueue or an AwaitQueue.
+    template <typename WaitQueue>
+    struct ParkedRequests
+    {
+        WaitQueue queue;
+    };
+
+    template <>
+    struct ParkedRequests<void>
+    { };
+
+
+    // Which of the pool's slots hold live objects, for pools with a LiveMap.
+    template <typename LiveMap>
+    struct LiveSlots
+    {
+        LiveMap map;
+    };
+
+    template <>
+    struct LiveSlots<void>
+    { };
+
+
+    // Tag for request(sop::DEFAULT_INIT) and the other requests - the object is default-initialized instead of
+    // value-initialized, so a trivial T is left with whatever bytes its slot held rather than zeroed,
+    // for objects which are about to be overwritten anyway.
+    struct DefaultInit
+    {
+        explicit DefaultInit() = default;
+    };
+
+    inline constexpr DefaultInit DEFAULT_INIT{};
+
+    // Constructs a T in slot from args - T{ args... }, or default-initialized for args of just DEFAULT_INIT.
+    template <typename T, typename... Args>
+    [[nodiscard]] T* constructAt(void* slot, Args&&... args) noexcept(false)
+    {
+        if constexpr (sizeof...(Args) == 1U && (std::is_same_v<std::remove_cvref_t<Args>, DefaultInit> && ...))
+        {
+            return new (slot) T;
+        }
+        else
+        {
+            return new (slot) T{ std::forward<Args>(args)... };
+        }
+    }
+
+
+    // How T is laid out in the pool's slots - the slots are ALIGNMENT aligned, and SIZE bytes apart.
+    template <PoolItemConcept T, typename Traits>
+    struct SlotLayout
+    {
+        static constexpr std::size_t ALIGNMENT{ std::max(alignof(T), Traits::SLOT_ALIGNMENT) };
+        static constexpr std::size_t SIZE{ (std::max(sizeof(T), Traits::SLOT_STRIDE) + ALIGNMENT - 1U) / ALIGNMENT * ALIGNMENT };
+
+        static_assert(std::has_single_bit(ALIGNMENT), "SLOT_ALIGNMENT must be a power of two.");
+    };
+
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits = DefaultPoolTraits>
     class StackfullObjectPool;
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits = DefaultPoolTraits>
     class PoolItemDeleter
     {
     public:
@@ -24,7 +247,7 @@ namespace sop
         //    : objectPool_{ nullptr }
         //{ }
 
-        PoolItemDeleter(StackfullObjectPool<T, CAPACITY>& objectPool)
+        PoolItemDeleter(StackfullObjectPool<T, CAPACITY, Traits>& objectPool)
             : objectPool_{ &objectPool }
         { }
 
@@ -37,11 +260,24 @@ namespace sop
         }
 
     private:
-        StackfullObjectPool<T, CAPACITY>* objectPool_;
+        StackfullObjectPool<T, CAPACITY, Traits>* objectPool_;
+    };
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits = DefaultPoolTraits>
+    using PoolItem = std::unique_ptr<T, const PoolItemDeleter<T, CAPACITY, Traits>&>;
+
+    // Stateless deleter of CompactPoolItem, which finds the pool from the object's address -
+    // the pool's Storage must provide owner(address), as SizeAlignedStorage does.
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits = DefaultPoolTraits>
+    class CompactPoolItemDeleter
+    {
+    public:
+        void operator()(T* obj) const noexcept;
     };
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
-    using PoolItem = std::unique_ptr<T, const PoolItemDeleter<T, CAPACITY>&>;
+    // A PoolItem a single pointer wide.
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits = DefaultPoolTraits>
+    using CompactPoolItem = std::unique_ptr<T, CompactPoolItemDeleter<T, CAPACITY, Traits>>;
 
     // NOTE: if you need a defualt ctor for PoolItem you can define
     // using PoolItem = std::unique_ptr<T, PoolItemDeleter<T, CAPACITY>>;
@@ -49,6 +285,51 @@ namespace sop
     // but if you allow for that, you also allow for the following undefined behavior - 
     // sop::PoolItem<int, 2U> pInt; *pInt = 17;
 
+    // Objects of one pool requested together with requestN(). Their slots go back to the free list together,
+    // with a single bulk release (a single lock or CAS for most free lists), once the batch is cleared or destroyed.
+    // A cleared batch keeps its buffers, so a batch reused for every burst stops allocating once it's warmed up.
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits = DefaultPoolTraits>
+    class PoolBatch
+    {
+    public:
+        explicit PoolBatch(StackfullObjectPool<T, CAPACITY, Traits>& objectPool) noexcept;
+
+        PoolBatch(PoolBatch&& other) noexcept = default;
+
+        PoolBatch& operator=(const PoolBatch& other) = delete;
+
+        ~PoolBatch();
+
+        [[nodiscard]] T& operator[](std::size_t i) const noexcept;
+
+        [[nodiscard]] T* const* begin() const noexcept;
+
+        [[nodiscard]] T* const* end() const noexcept;
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        [[nodiscard]] bool empty() const noexcept;
+
+        void clear() noexcept;
+
+    private:
+        friend class StackfullObjectPool<T, CAPACITY, Traits>;
+
+        StackfullObjectPool<T, CAPACITY, Traits>* objectPool_;
+        std::vector<T*> objects_;
+        // room for the indices of all objects_, handed to the free list's bulk acquire and release
+        std::vector<std::size_t> indices_;
+    };
+
+    // What requestN() does when the pool can't fill the whole batch.
+    enum class BatchMode
+    {
+        // requests as many objects as there are open slots
+        AS_MANY_AS_OPEN,
+        // requests none at all
+        ALL_OR_NOTHING
+    };
+
     class max_capacity_exception : public std::bad_alloc
     {
     public:
@@ -59,99 +340,644 @@ namespace sop
     };
 
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
     class StackfullObjectPool
     {
     public:
-        StackfullObjectPool() noexcept;
+        using FreeList = typename Traits::template FreeList<CAPACITY>;
+        using Layout = SlotLayout<T, Traits>;
+        using OverflowAllocator = typename Traits::template OverflowAllocator<T>;
+        using WaitQueue = typename Traits::WaitQueue;
+        using AwaitQueue = typename Traits::AwaitQueue;
+        using LiveMap = typename Traits::template LiveMap<CAPACITY>;
+
+        static_assert(FITS_FREE_LIST<FreeList, Layout::SIZE>, "T is too small to hold the free list's links, pick another FreeList.");
+
+        static constexpr bool OVERFLOWS{ !std::is_void_v<OverflowAllocator> };
+        static constexpr bool BLOCKS{ !std::is_void_v<WaitQueue> };
+        static constexpr bool AWAITS{ !std::is_void_v<AwaitQueue> };
+        static constexpr bool TRACKS_LIVE{ !std::is_void_v<LiveMap> };
+
+        template <CoroutineExecutor Executor, typename... Args>
+        class AsyncRequest;
+
+        StackfullObjectPool() noexcept(std::is_nothrow_constructible_v<Storage, StackfullObjectPool&>);
+
+        template <typename... Args>
+        [[nodiscard]] PoolItem<T, CAPACITY, Traits> request(Args&&... args) noexcept(false);
+
+        // as request(), but an exhausted pool returns an empty optional rather than going through Traits::ErrorPolicy
+        template <typename... Args>
+        [[nodiscard]] std::optional<PoolItem<T, CAPACITY, Traits>> tryRequest(Args&&... args) noexcept(false);
 
+        // as request(), but the item is a single pointer wide - it needs a Storage which finds the pool from
+        // an object's address (e.g. CompactPoolTraits), and a pool without an OverflowAllocator
+        template <typename... Args>
+        [[nodiscard]] CompactPoolItem<T, CAPACITY, Traits> requestCompact(Args&&... args) noexcept(false);
+
+        // as tryRequest(), but a full pool parks the caller until a release frees a slot,
+        // and only returns an empty optional once deadline passes
+        template <typename Clock, typename Duration, typename... Args>
+        [[nodiscard]] std::optional<PoolItem<T, CAPACITY, Traits>> requestUntil(const std::chrono::time_point<Clock, Duration>& deadline, Args&&... args) noexcept(false) requires BLOCKS;
+
+        template <typename Rep, typename Period, typename... Args>
+        [[nodiscard]] std::optional<PoolItem<T, CAPACITY, Traits>> requestFor(const std::chrono::duration<Rep, Period>& timeout, Args&&... args) noexcept(false) requires BLOCKS;
+
+        // co_await pool.asyncRequest(executor, args...) yields a PoolItem; a full pool parks the coroutine
+        // until a release hands it a slot, and then resumes it on executor. It waits for a slot rather than
+        // turning to the OverflowAllocator, and keeps copies of args until then.
+        // A coroutine may be destroyed while it's parked, and once it was handed to executor, after it's taken off executor's queue.
+        template <CoroutineExecutor Executor, typename... Args>
+        [[nodiscard]] AsyncRequest<Executor, Args...> asyncRequest(Executor& executor, Args&&... args) noexcept(false) requires AWAITS;
+
+        // appends count objects, each constructed from args, to batch, acquiring their slots with a single bulk
+        // acquire of the free list, and returns how many it appended - fewer than count once the pool runs out
+        // (none with BatchMode::ALL_OR_NOTHING). It doesn't go through Traits::ErrorPolicy, nor turn to the OverflowAllocator.
+        // If a constructor throws, the objects constructed before it stay in batch and the other slots are released.
         template <typename... Args>
-        [[nodiscard]] PoolItem<T, CAPACITY> request(Args&&... args) noexcept(false);
+        [[nodiscard]] std::size_t requestN(std::size_t count, PoolBatch<T, CAPACITY, Traits>& batch, BatchMode mode, const Args&... args) noexcept(false);
+
+        // calls fn(obj) for every live object in the pool's slots, lowest address first - not for those from the
+        // OverflowAllocator. Objects requested meanwhile may or may not be visited, and none may be released until it returns.
+        template <typename Fn>
+        void forEachLive(Fn&& fn) noexcept(false) requires TRACKS_LIVE;
+
+        // as forEachLive(fn), but only visits the part-th of parts equal ranges of the slots,
+        // so a thread pool (or std::for_each with std::execution::par) may visit the parts in parallel -
+        // part must be less than parts, otherwise the ErrorPolicy fails with std::out_of_range
+        template <typename Fn>
+        void forEachLive(std::size_t part, std::size_t parts, Fn&& fn) noexcept(false) requires TRACKS_LIVE;
+
+        // as forEachLive(fn), but splits the slots into parts parts and hands them to executor to visit in parallel -
+        // fn is called concurrently, and mustn't throw
+        template <BulkExecutor Executor, typename Fn>
+        void forEachLiveParallel(Executor& executor, std::size_t parts, Fn&& fn) noexcept(false) requires TRACKS_LIVE;
 
         [[nodiscard]] consteval std::size_t capacity() const noexcept;
 
+        // counts the objects handed out from the pool's slots, not those from the OverflowAllocator
         [[nodiscard]] std::size_t size() const noexcept;
         
         [[nodiscard]] bool isFull() const noexcept;
 
+        // the number of objects allocated with the OverflowAllocator so far, a sign CAPACITY is too small
+        [[nodiscard]] std::size_t overflowCount() const noexcept requires OVERFLOWS;
+
     private:
-        friend class PoolItemDeleter<T, CAPACITY>;
+        friend class PoolItemDeleter<T, CAPACITY, Traits>;
+        friend class PoolBatch<T, CAPACITY, Traits>;
+        friend class CompactPoolItemDeleter<T, CAPACITY, Traits>;
 
-        std::array<std::byte, sizeof(T) * CAPACITY> pool_;
-        T* const poolStart_;
-        std::array<std::size_t, CAPACITY> stack_;
-        std::size_t stackTop_;
-        std::size_t size_;
-        std::mutex mutex_;
-        const PoolItemDeleter<T, CAPACITY> poolItemDeleter_;
+        struct Slab
+        {
+            explicit Slab(StackfullObjectPool& objectPool) noexcept
+                : pool{}
+                , freeList{ makeFreeList<FreeList, Layout::SIZE>(pool.data()) }
+                , poolItemDeleter{ objectPool }
+                , overflow{}
+                , parked{}
+                , awaiting{}
+                , live{}
+            { }
+
+            alignas(Layout::ALIGNMENT) std::array<std::byte, Layout::SIZE * CAPACITY> pool;
+            // the free list's bookkeeping starts on a line of its own, away from the last objects in pool
+            alignas(CACHE_LINE_SIZE) FreeList freeList;
+            const PoolItemDeleter<T, CAPACITY, Traits> poolItemDeleter;
+            [[no_unique_address]] OverflowHeap<OverflowAllocator> overflow;
+            [[no_unique_address]] ParkedRequests<WaitQueue> parked;
+            [[no_unique_address]] ParkedRequests<AwaitQueue> awaiting;
+            [[no_unique_address]] LiveSlots<LiveMap> live;
+        };
+
+        using Storage = typename Traits::template Storage<Slab>;
+
+        Storage storage_;
+
+        // nullptr once the pool is exhausted
+        template <typename... Args>
+        [[nodiscard]] T* tryConstruct(Args&&... args) noexcept(false);
+
+        // nullptr once every slot is handed out
+        [[nodiscard]] std::byte* acquireSlot() noexcept;
 
         void release(T* obj) noexcept;
+
+        // objs all come from the pool's slots, indices has room for all of them
+        void release(std::span<T* const> objs, std::vector<std::size_t>& indices) noexcept;
+
+        // serves the requests parked on the pool once released slots went back to the free list
+        void wakeParked(std::size_t released) noexcept;
+
+        // obj was just constructed in one of the slots, forEachLive() may visit it from now on
+        T* markLive(T* obj) noexcept;
+
+        // obj, from one of the slots, is about to be released
+        void unmarkLive(const T* obj) noexcept;
+    };
+
+
+    // The awaitable returned by asyncRequest().
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <CoroutineExecutor Executor, typename... Args>
+    class StackfullObjectPool<T, CAPACITY, Traits>::AsyncRequest : private CoroutineWaitQueue::Waiter
+    {
+    public:
+        AsyncRequest(StackfullObjectPool& objectPool, Executor& executor, Args&&... args) noexcept(false);
+
+        AsyncRequest(const AsyncRequest&) = delete;
+        AsyncRequest& operator=(const AsyncRequest&) = delete;
+
+        ~AsyncRequest();
+
+        [[nodiscard]] bool await_ready() noexcept;
+
+        [[nodiscard]] bool await_suspend(std::coroutine_handle<> handle) noexcept(false);
+
+        [[nodiscard]] PoolItem<T, CAPACITY, Traits> await_resume() noexcept(false);
+
+    private:
+        StackfullObjectPool* objectPool_;
+        Executor* executor_;
+        std::coroutine_handle<> handle_;
+        std::tuple<std::decay_t<Args>...> args_;
+        // set from parking until the coroutine resumes
+        bool parked_;
+
+        static void resumeOnExecutor(CoroutineWaitQueue::Waiter& waiter) noexcept;
     };
 
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
-    StackfullObjectPool<T, CAPACITY>::StackfullObjectPool() noexcept
-        : pool_{}
-        , poolStart_{ reinterpret_cast<T* const>(pool_.data()) }
-        , stack_{}
-        , stackTop_{ 0U }
-        , size_{ 0U }
-        , mutex_{}
-        , poolItemDeleter_{ *this }
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    StackfullObjectPool<T, CAPACITY, Traits>::StackfullObjectPool() noexcept(std::is_nothrow_constructible_v<Storage, StackfullObjectPool&>)
+        : storage_{ *this }
+    { }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename... Args>
+    PoolItem<T, CAPACITY, Traits> StackfullObjectPool<T, CAPACITY, Traits>::request(Args&&... args) noexcept(false)
     {
-        for (std::size_t i{ 0U }; i != CAPACITY; ++i)
+        T* const obj{ tryConstruct(std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
         {
-            stack_[i] = i;
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
         }
+
+        return { obj, storage_->poolItemDeleter };
     }
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
     template <typename... Args>
-    PoolItem<T, CAPACITY> StackfullObjectPool<T, CAPACITY>::request(Args&&... args) noexcept(false)
+    std::optional<PoolItem<T, CAPACITY, Traits>> StackfullObjectPool<T, CAPACITY, Traits>::tryRequest(Args&&... args) noexcept(false)
     {
-        std::lock_guard lock{ mutex_ };
+        T* const obj{ tryConstruct(std::forward<Args>(args)...) };
 
-        if (stackTop_ == CAPACITY) [[unlikely]]
+        if (obj == nullptr) [[unlikely]]
         {
-            throw max_capacity_exception{};
+            return std::nullopt;
         }
 
-        ++stackTop_;
+        return std::optional<PoolItem<T, CAPACITY, Traits>>{ std::in_place, obj, storage_->poolItemDeleter };
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename... Args>
+    CompactPoolItem<T, CAPACITY, Traits> StackfullObjectPool<T, CAPACITY, Traits>::requestCompact(Args&&... args) noexcept(false)
+    {
+        static_assert(requires { Storage::owner(nullptr); }, "Compact items need a Storage with owner(address), e.g. SizeAlignedStorage.");
+        static_assert(!OVERFLOWS, "Compact items can't tell the OverflowAllocator's objects apart.");
 
-        ++size_;
+        T* const obj{ tryConstruct(std::forward<Args>(args)...) };
+
+        if (obj == nullptr) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<max_capacity_exception>();
+        }
 
-        return { new (&pool_[stack_[stackTop_ - 1U] * sizeof(T)]) T{ std::forward<Args>(args)... }, poolItemDeleter_ };
+        return CompactPoolItem<T, CAPACITY, Traits>{ obj };
     }
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
-    void StackfullObjectPool<T, CAPACITY>::release(T* obj) noexcept
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename Clock, typename Duration, typename... Args>
+    std::optional<PoolItem<T, CAPACITY, Traits>> StackfullObjectPool<T, CAPACITY, Traits>::requestUntil(const std::chrono::time_point<Clock, Duration>& deadline, Args&&... args) noexcept(false) requires BLOCKS
     {
-        std::lock_guard lock{ mutex_ };
+        T* obj{ tryConstruct(std::forward<Args>(args)...) };
 
-        const std::size_t freedObjIdx{ static_cast<std::size_t>(obj - poolStart_) };
+        if (obj == nullptr) [[unlikely]]
+        {
+            // args are only forwarded by the call which finds an open slot
+            obj = storage_->parked.queue.waitUntil(deadline, [this, &args...]() { return tryConstruct(std::forward<Args>(args)...); });
 
-        --stackTop_;
-        stack_[stackTop_] = freedObjIdx;
+            if (obj == nullptr)
+            {
+                return std::nullopt;
+            }
+        }
 
-        --size_;
+        return std::optional<PoolItem<T, CAPACITY, Traits>>{ std::in_place, obj, storage_->poolItemDeleter };
     }
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
-    consteval std::size_t StackfullObjectPool<T, CAPACITY>::capacity() const noexcept
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename Rep, typename Period, typename... Args>
+    std::optional<PoolItem<T, CAPACITY, Traits>> StackfullObjectPool<T, CAPACITY, Traits>::requestFor(const std::chrono::duration<Rep, Period>& timeout, Args&&... args) noexcept(false) requires BLOCKS
+    {
+        return requestUntil(std::chrono::steady_clock::now() + timeout, std::forward<Args>(args)...);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <CoroutineExecutor Executor, typename... Args>
+    auto StackfullObjectPool<T, CAPACITY, Traits>::asyncRequest(Executor& executor, Args&&... args) noexcept(false) -> AsyncRequest<Executor, Args...> requires AWAITS
+    {
+        return { *this, executor, std::forward<Args>(args)... };
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename... Args>
+    std::size_t StackfullObjectPool<T, CAPACITY, Traits>::requestN(std::size_t count, PoolBatch<T, CAPACITY, Traits>& batch, BatchMode mode, const Args&... args) noexcept(false)
+    {
+        const std::size_t first{ batch.objects_.size() };
+
+        batch.objects_.reserve(first + count);
+        batch.indices_.resize(first + count);
+
+        const std::span<std::size_t> indices{ batch.indices_.data() + first, count };
+        const std::size_t acquired{ acquireBulk(storage_->freeList, indices) };
+
+        if (acquired != count && mode == BatchMode::ALL_OR_NOTHING)
+        {
+            releaseBulk(storage_->freeList, std::span<const std::size_t>{ indices.data(), acquired });
+
+            wakeParked(acquired);
+
+            return 0U;
+        }
+
+        std::size_t constructed{ 0U };
+
+        // should a constructor throw, the slots still without an object go back to the free list,
+        // while the objects constructed so far stay in batch
+        struct Rollback
+        {
+            StackfullObjectPool& pool;
+            const std::span<const std::size_t> indices;
+            const std::size_t& constructed;
+
+            ~Rollback()
+            {
+                if (constructed != indices.size()) [[unlikely]]
+                {
+                    releaseBulk(pool.storage_->freeList, indices.subspan(constructed));
+
+                    pool.wakeParked(indices.size() - constructed);
+                }
+            }
+        } rollback{ *this, std::span<const std::size_t>{ indices.data(), acquired }, constructed };
+
+        for (; constructed != acquired; ++constructed)
+        {
+            batch.objects_.push_back(markLive(constructAt<T>(&storage_->pool[indices[constructed] * Layout::SIZE], args...)));
+        }
+
+        return acquired;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename... Args>
+    T* StackfullObjectPool<T, CAPACITY, Traits>::tryConstruct(Args&&... args) noexcept(false)
+    {
+        std::byte* const slot{ acquireSlot() };
+
+        if (slot == nullptr) [[unlikely]]
+        {
+            if constexpr (OVERFLOWS)
+            {
+                T* const obj{ std::allocator_traits<OverflowAllocator>::allocate(storage_->overflow.allocator, 1U) };
+                storage_->overflow.count.fetch_add(1U, std::memory_order_relaxed);
+
+                return constructAt<T>(obj, std::forward<Args>(args)...);
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+
+        return markLive(constructAt<T>(slot, std::forward<Args>(args)...));
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    std::byte* StackfullObjectPool<T, CAPACITY, Traits>::acquireSlot() noexcept
+    {
+        std::size_t idx;
+
+        if (!storage_->freeList.acquire(idx)) [[unlikely]]
+        {
+            return nullptr;
+        }
+
+        return &storage_->pool[idx * Layout::SIZE];
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    void StackfullObjectPool<T, CAPACITY, Traits>::release(T* obj) noexcept
+    {
+        if constexpr (OVERFLOWS)
+        {
+            // an object outside pool (wrapping around below it) came from the OverflowAllocator
+            const std::uintptr_t offset{ reinterpret_cast<std::uintptr_t>(obj) - reinterpret_cast<std::uintptr_t>(storage_->pool.data()) };
+
+            if (offset >= storage_->pool.size()) [[unlikely]]
+            {
+                std::allocator_traits<OverflowAllocator>::deallocate(storage_->overflow.allocator, obj, 1U);
+
+                return;
+            }
+        }
+
+        unmarkLive(obj);
+
+        if constexpr (AWAITS)
+        {
+            // the slot skips the free list, the coroutine which parked first gets it
+            if (storage_->awaiting.queue.handOff(reinterpret_cast<std::byte*>(obj)))
+            {
+                return;
+            }
+        }
+
+        const std::size_t freedObjIdx{ static_cast<std::size_t>(reinterpret_cast<std::byte*>(obj) - storage_->pool.data()) / Layout::SIZE };
+
+        storage_->freeList.release(freedObjIdx);
+
+        wakeParked(1U);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    void StackfullObjectPool<T, CAPACITY, Traits>::release(std::span<T* const> objs, std::vector<std::size_t>& indices) noexcept
+    {
+        std::size_t count{ 0U };
+
+        for (T* const obj : objs)
+        {
+            unmarkLive(obj);
+
+            if constexpr (AWAITS)
+            {
+                if (storage_->awaiting.queue.handOff(reinterpret_cast<std::byte*>(obj)))
+                {
+                    continue;
+                }
+            }
+
+            indices[count] = static_cast<std::size_t>(reinterpret_cast<std::byte*>(obj) - storage_->pool.data()) / Layout::SIZE;
+            ++count;
+        }
+
+        releaseBulk(storage_->freeList, std::span<const std::size_t>{ indices.data(), count });
+
+        wakeParked(count);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    void StackfullObjectPool<T, CAPACITY, Traits>::wakeParked(std::size_t released) noexcept
+    {
+        if (released == 0U)
+        {
+            return;
+        }
+
+        if constexpr (AWAITS)
+        {
+            storage_->awaiting.queue.drain([this]() { return acquireSlot(); });
+        }
+
+        if constexpr (BLOCKS)
+        {
+            storage_->parked.queue.notify(released);
+        }
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    T* StackfullObjectPool<T, CAPACITY, Traits>::markLive(T* obj) noexcept
+    {
+        if constexpr (TRACKS_LIVE)
+        {
+            storage_->live.map.mark(static_cast<std::size_t>(reinterpret_cast<std::byte*>(obj) - storage_->pool.data()) / Layout::SIZE);
+        }
+
+        return obj;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    void StackfullObjectPool<T, CAPACITY, Traits>::unmarkLive([[maybe_unused]] const T* obj) noexcept
+    {
+        if constexpr (TRACKS_LIVE)
+        {
+            storage_->live.map.unmark(static_cast<std::size_t>(reinterpret_cast<const std::byte*>(obj) - storage_->pool.data()) / Layout::SIZE);
+        }
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename Fn>
+    void StackfullObjectPool<T, CAPACITY, Traits>::forEachLive(Fn&& fn) noexcept(false) requires TRACKS_LIVE
+    {
+        forEachLive(0U, 1U, fn);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <typename Fn>
+    void StackfullObjectPool<T, CAPACITY, Traits>::forEachLive(std::size_t part, std::size_t parts, Fn&& fn) noexcept(false) requires TRACKS_LIVE
+    {
+        // parts split at word boundaries, so no two parts share a word of the map
+        constexpr std::size_t WORDS{ LiveMap::WORDS };
+
+        if (part >= parts) [[unlikely]]
+        {
+            Traits::ErrorPolicy::template fail<std::out_of_range>("forEachLive part must be less than parts.");
+        }
+
+        auto visit{ [this, &fn](std::size_t idx) { fn(*reinterpret_cast<T*>(&storage_->pool[idx * Layout::SIZE])); } };
+
+        storage_->live.map.forEach(WORDS * part / parts, WORDS * (part + 1U) / parts, visit);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <BulkExecutor Executor, typename Fn>
+    void StackfullObjectPool<T, CAPACITY, Traits>::forEachLiveParallel(Executor& executor, std::size_t parts, Fn&& fn) noexcept(false) requires TRACKS_LIVE
+    {
+        parts = std::max(parts, std::size_t{ 1U });
+
+        const auto visitPart{ [this, parts, &fn](std::size_t part) { forEachLive(part, parts, fn); } };
+        // only a reference to visitPart is erased, which std::function stores without allocating
+        const BulkTask task{ [&visitPart](std::size_t part) { visitPart(part); } };
+
+        executor(parts, task);
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    consteval std::size_t StackfullObjectPool<T, CAPACITY, Traits>::capacity() const noexcept
     {
         return CAPACITY;
     }
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
-    std::size_t StackfullObjectPool<T, CAPACITY>::size() const noexcept
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    std::size_t StackfullObjectPool<T, CAPACITY, Traits>::size() const noexcept
+    {
+        return storage_->freeList.size();
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    bool StackfullObjectPool<T, CAPACITY, Traits>::isFull() const noexcept
+    {
+        return storage_->freeList.size() == CAPACITY;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    std::size_t StackfullObjectPool<T, CAPACITY, Traits>::overflowCount() const noexcept requires OVERFLOWS
+    {
+        return storage_->overflow.count.load(std::memory_order_relaxed);
+    }
+
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    void CompactPoolItemDeleter<T, CAPACITY, Traits>::operator()(T* obj) const noexcept
+    {
+        // NOTE: as with PoolItem, the pool's lifetime must exceed that of its objects
+
+        StackfullObjectPool<T, CAPACITY, Traits>::Storage::owner(obj)->poolItemDeleter(obj);
+    }
+
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    PoolBatch<T, CAPACITY, Traits>::PoolBatch(StackfullObjectPool<T, CAPACITY, Traits>& objectPool) noexcept
+        : objectPool_{ &objectPool }
+        , objects_{}
+        , indices_{}
+    { }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    PoolBatch<T, CAPACITY, Traits>::~PoolBatch()
+    {
+        clear();
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    T& PoolBatch<T, CAPACITY, Traits>::operator[](std::size_t i) const noexcept
+    {
+        return *objects_[i];
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    T* const* PoolBatch<T, CAPACITY, Traits>::begin() const noexcept
+    {
+        return objects_.data();
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    T* const* PoolBatch<T, CAPACITY, Traits>::end() const noexcept
+    {
+        return objects_.data() + objects_.size();
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    std::size_t PoolBatch<T, CAPACITY, Traits>::size() const noexcept
+    {
+        return objects_.size();
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    bool PoolBatch<T, CAPACITY, Traits>::empty() const noexcept
+    {
+        return objects_.empty();
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    void PoolBatch<T, CAPACITY, Traits>::clear() noexcept
+    {
+        if (objects_.empty())
+        {
+            return;
+        }
+
+        objectPool_->release(std::span<T* const>{ objects_ }, indices_);
+        objects_.clear();
+    }
+
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <CoroutineExecutor Executor, typename... Args>
+    StackfullObjectPool<T, CAPACITY, Traits>::AsyncRequest<Executor, Args...>::AsyncRequest(StackfullObjectPool& objectPool, Executor& executor, Args&&... args) noexcept(false)
+        : CoroutineWaitQueue::Waiter{ nullptr, nullptr, &resumeOnExecutor }
+        , objectPool_{ &objectPool }
+        , executor_{ &executor }
+        , handle_{}
+        , args_{ std::forward<Args>(args)... }
+        , parked_{ false }
+    { }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <CoroutineExecutor Executor, typename... Args>
+    StackfullObjectPool<T, CAPACITY, Traits>::AsyncRequest<Executor, Args...>::~AsyncRequest()
+    {
+        // the coroutine was destroyed while parked - leave the queue, or give back the slot a release handed it
+        if (parked_ && objectPool_->storage_->awaiting.queue.cancel(*this))
+        {
+            return;
+        }
+
+        if (this->slot != nullptr)
+        {
+            objectPool_->release(reinterpret_cast<T*>(this->slot));
+        }
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <CoroutineExecutor Executor, typename... Args>
+    bool StackfullObjectPool<T, CAPACITY, Traits>::AsyncRequest<Executor, Args...>::await_ready() noexcept
+    {
+        this->slot = objectPool_->acquireSlot();
+
+        return this->slot != nullptr;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <CoroutineExecutor Executor, typename... Args>
+    bool StackfullObjectPool<T, CAPACITY, Traits>::AsyncRequest<Executor, Args...>::await_suspend(std::coroutine_handle<> handle) noexcept(false)
+    {
+        handle_ = handle;
+        parked_ = true;
+
+        // once parked, a release may resume the coroutine on another thread at any moment, so this must not be touched anymore
+        if (objectPool_->storage_->awaiting.queue.park(*this, [objectPool = objectPool_]() { return objectPool->acquireSlot(); }))
+        {
+            return true;
+        }
+
+        parked_ = false;
+
+        return false;
+    }
+
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <CoroutineExecutor Executor, typename... Args>
+    PoolItem<T, CAPACITY, Traits> StackfullObjectPool<T, CAPACITY, Traits>::AsyncRequest<Executor, Args...>::await_resume() noexcept(false)
     {
-        return size_;
+        parked_ = false;
+
+        T* const obj{ objectPool_->markLive(std::apply([slot = this->slot](auto&... args) { return constructAt<T>(slot, args...); }, args_)) };
+        this->slot = nullptr;
+
+        return { obj, objectPool_->storage_->poolItemDeleter };
     }
 
-    template <PoolItemConcept T, std::size_t CAPACITY>
-    bool StackfullObjectPool<T, CAPACITY>::isFull() const noexcept
+    template <PoolItemConcept T, std::size_t CAPACITY, typename Traits>
+    template <CoroutineExecutor Executor, typename... Args>
+    void StackfullObjectPool<T, CAPACITY, Traits>::AsyncRequest<Executor, Args...>::resumeOnExecutor(CoroutineWaitQueue::Waiter& waiter) noexcept
     {
-        return size_ == CAPACITY;
+        AsyncRequest& request{ static_cast<AsyncRequest&>(waiter) };
+
+        (*request.executor_)(request.handle_);
     }
 }
 
@@ -0,0 +1,680 @@
+﻿#include "StackfullObjectPool.hpp"
+#include "ShardedObjectPool.hpp"
+#include "SoaObjectPool.hpp"
+
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+
+// Build in Release and run with e.g. --benchmark-samples 10
+
+namespace
+{
+	constexpr std::size_t OPS_PER_THREAD{ 100'000U };
+
+	// with fewer cores than threads the threads take turns rather than contend, so a contention benchmark's
+	// numbers say nothing about how the free lists behave under contention
+	void warnUnlessCores(std::size_t threadCount)
+	{
+		if (std::thread::hardware_concurrency() < threadCount)
+		{
+			WARN("Only " << std::thread::hardware_concurrency() << " hardware threads for up to " << threadCount
+				<< " benchmark threads - these results don't show contention.");
+		}
+	}
+
+	template <typename Pool>
+	void requestReleaseLoop(Pool& pool, std::size_t threadCount)
+	{
+		std::vector<std::thread> threads{};
+
+		for (std::size_t t{ 0U }; t != threadCount; ++t)
+		{
+			threads.emplace_back([&pool]()
+				{
+					for (std::size_t i{ 0U }; i != OPS_PER_THREAD; ++i)
+					{
+						auto item = pool.request(i);
+						++*item;
+					}
+				});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	// one thread requests items and hands them over a single producer single consumer ring
+	// to another thread which releases them
+	template <typename Pool, typename Item>
+	void producerConsumerLoop(Pool& pool)
+	{
+		constexpr std::size_t RING_SIZE{ 256U };
+
+		std::array<std::optional<Item>, RING_SIZE> ring{};
+		std::atomic<std::size_t> produced{ 0U };
+		std::atomic<std::size_t> consumed{ 0U };
+
+		std::thread consumer{ [&]()
+			{
+				for (std::size_t i{ 0U }; i != OPS_PER_THREAD; ++i)
+				{
+					while (produced.load(std::memory_order_acquire) == i)
+					{
+						std::this_thread::yield();
+					}
+
+					ring[i % RING_SIZE].reset();
+					consumed.store(i + 1U, std::memory_order_release);
+				}
+			} };
+
+		for (std::size_t i{ 0U }; i != OPS_PER_THREAD; ++i)
+		{
+			while (i - consumed.load(std::memory_order_acquire) == RING_SIZE)
+			{
+				std::this_thread::yield();
+			}
+
+			ring[i % RING_SIZE].emplace(pool.request(i));
+			produced.store(i + 1U, std::memory_order_release);
+		}
+
+		consumer.join();
+	}
+
+	// a bulk executor whose worker threads are started once and wait for work between calls,
+	// the calling thread takes its share of the tasks too
+	class WorkerTeam
+	{
+	public:
+		explicit WorkerTeam(std::size_t workers)
+		{
+			for (std::size_t w{ 0U }; w != workers; ++w)
+			{
+				threads_.emplace_back([this, w]() { work(w + 1U); });
+			}
+		}
+
+		~WorkerTeam()
+		{
+			{
+				std::lock_guard lock{ mutex_ };
+				stopping_ = true;
+			}
+
+			wake_.notify_all();
+		}
+
+		void operator()(std::size_t count, const sop::BulkTask& task)
+		{
+			{
+				std::lock_guard lock{ mutex_ };
+				task_ = &task;
+				count_ = count;
+				pending_ = threads_.size();
+				++generation_;
+			}
+
+			wake_.notify_all();
+			run(task, count, 0U);
+
+			std::unique_lock lock{ mutex_ };
+			done_.wait(lock, [this]() { return pending_ == 0U; });
+		}
+
+	private:
+		std::mutex mutex_{};
+		std::condition_variable wake_{};
+		std::condition_variable done_{};
+		const sop::BulkTask* task_{ nullptr };
+		std::size_t count_{ 0U };
+		std::size_t pending_{ 0U };
+		std::size_t generation_{ 0U };
+		bool stopping_{ false };
+		std::vector<std::jthread> threads_{};
+
+		void run(const sop::BulkTask& task, std::size_t count, std::size_t first) const
+		{
+			for (std::size_t i{ first }; i < count; i += threads_.size() + 1U)
+			{
+				task(i);
+			}
+		}
+
+		void work(std::size_t first)
+		{
+			std::size_t seen{ 0U };
+			std::unique_lock lock{ mutex_ };
+
+			for (;;)
+			{
+				wake_.wait(lock, [this, seen]() { return stopping_ || generation_ != seen; });
+
+				if (stopping_)
+				{
+					return;
+				}
+
+				seen = generation_;
+				const sop::BulkTask& task{ *task_ };
+				const std::size_t count{ count_ };
+
+				lock.unlock();
+				run(task, count, first);
+				lock.lock();
+
+				if (--pending_ == 0U)
+				{
+					done_.notify_one();
+				}
+			}
+		}
+	};
+}
+
+
+TEST_CASE("request/release throughput by thread count", "[benchmark]")
+{
+	static sop::StackfullObjectPool<std::size_t, 1024U, sop::LockedPoolTraits> lockedPool{};
+	static sop::StackfullObjectPool<std::size_t, 1024U, sop::LockFreePoolTraits> lockFreePool{};
+	static sop::StackfullObjectPool<std::size_t, 1024U, sop::MagazinePoolTraits> magazinePool{};
+	static sop::StackfullObjectPool<std::size_t, 1024U, sop::PerCpuPoolTraits> perCpuPool{};
+	static sop::ShardedObjectPool<std::size_t, 1024U, 16U, sop::LockedPoolTraits> shardedPool{};
+
+	warnUnlessCores(16U);
+
+	for (const std::size_t threadCount : { 1U, 2U, 4U, 8U, 16U })
+	{
+		BENCHMARK("locked stack, " + std::to_string(threadCount) + " threads")
+		{
+			requestReleaseLoop(lockedPool, threadCount);
+		};
+
+		BENCHMARK("lock-free stack, " + std::to_string(threadCount) + " threads")
+		{
+			requestReleaseLoop(lockFreePool, threadCount);
+		};
+
+		BENCHMARK("magazine cache, " + std::to_string(threadCount) + " threads")
+		{
+			requestReleaseLoop(magazinePool, threadCount);
+		};
+
+		BENCHMARK("per-CPU try-locked cache, " + std::to_string(threadCount) + " threads")
+		{
+			requestReleaseLoop(perCpuPool, threadCount);
+		};
+
+		BENCHMARK("16 locked shards, " + std::to_string(threadCount) + " threads")
+		{
+			requestReleaseLoop(shardedPool, threadCount);
+		};
+	}
+}
+
+namespace
+{
+	constexpr std::size_t INCREMENTS_PER_THREAD{ 1'000'000U };
+
+	// every thread requests one counter and keeps incrementing it,
+	// so neighbouring slots on a shared cache line bounce it between the cores
+	template <typename Pool>
+	void pooledCounterLoop(Pool& pool, std::size_t threadCount)
+	{
+		std::vector<decltype(pool.request())> counters{};
+		std::vector<std::thread> threads{};
+
+		for (std::size_t t{ 0U }; t != threadCount; ++t)
+		{
+			counters.push_back(pool.request(std::uint64_t{ 0U }));
+		}
+
+		for (std::size_t t{ 0U }; t != threadCount; ++t)
+		{
+			threads.emplace_back([counter = counters[t].get()]()
+				{
+					const std::atomic_ref<std::uint64_t> count{ *counter };
+
+					for (std::size_t i{ 0U }; i != INCREMENTS_PER_THREAD; ++i)
+					{
+						count.fetch_add(1U, std::memory_order_relaxed);
+					}
+				});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+}
+
+TEST_CASE("false sharing between pooled objects", "[benchmark]")
+{
+	static sop::StackfullObjectPool<std::uint64_t, 64U> packedPool{};
+	static sop::StackfullObjectPool<std::uint64_t, 64U, sop::PaddedPoolTraits> paddedPool{};
+
+	warnUnlessCores(8U);
+
+	for (const std::size_t threadCount : { 1U, 2U, 4U, 8U })
+	{
+		BENCHMARK("packed 8 byte slots, " + std::to_string(threadCount) + " threads")
+		{
+			pooledCounterLoop(packedPool, threadCount);
+		};
+
+		BENCHMARK("cache line padded slots, " + std::to_string(threadCount) + " threads")
+		{
+			pooledCounterLoop(paddedPool, threadCount);
+		};
+	}
+}
+
+TEST_CASE("tiny pool throughput by thread count", "[benchmark]")
+{
+	static sop::StackfullObjectPool<std::size_t, 64U, sop::LockedPoolTraits> lockedPool{};
+	static sop::StackfullObjectPool<std::size_t, 64U> bitmapPool{};
+
+	for (const std::size_t threadCount : { 1U, 4U, 16U })
+	{
+		BENCHMARK("64 slots, locked stack, " + std::to_string(threadCount) + " threads")
+		{
+			requestReleaseLoop(lockedPool, threadCount);
+		};
+
+		BENCHMARK("64 slots, atomic bitmap, " + std::to_string(threadCount) + " threads")
+		{
+			requestReleaseLoop(bitmapPool, threadCount);
+		};
+	}
+}
+
+TEST_CASE("cross-thread release throughput", "[benchmark]")
+{
+	static sop::StackfullObjectPool<std::size_t, 1024U, sop::LockedPoolTraits> lockedPool{};
+	static sop::StackfullObjectPool<std::size_t, 1024U, sop::RemoteFreePoolTraits> remoteFreePool{};
+
+	warnUnlessCores(2U);
+
+	BENCHMARK("locked stack, producer/consumer")
+	{
+		producerConsumerLoop<decltype(lockedPool), sop::PoolItem<std::size_t, 1024U, sop::LockedPoolTraits>>(lockedPool);
+	};
+
+	BENCHMARK("remote-free list, producer/consumer")
+	{
+		producerConsumerLoop<decltype(remoteFreePool), sop::PoolItem<std::size_t, 1024U, sop::RemoteFreePoolTraits>>(remoteFreePool);
+	};
+}
+
+namespace
+{
+	template <typename Pool>
+	void requestReleaseBurst(Pool& pool, std::size_t count)
+	{
+		std::vector<decltype(pool.request())> items{};
+		items.reserve(count);
+
+		for (std::size_t i{ 0U }; i != count; ++i)
+		{
+			items.push_back(pool.request());
+		}
+	}
+
+	template <std::size_t CAPACITY>
+	void largePoolBenchmarks(const std::string& capacityName)
+	{
+		using StackPool = sop::StackfullObjectPool<int, CAPACITY, sop::LockedPoolTraits>;
+		using BitmapPool = sop::StackfullObjectPool<int, CAPACITY, sop::HierarchicalBitmapPoolTraits>;
+
+		BENCHMARK(capacityName + " slots, locked stack, construct")
+		{
+			return std::make_unique<StackPool>();
+		};
+
+		BENCHMARK(capacityName + " slots, hierarchical bitmap, construct")
+		{
+			return std::make_unique<BitmapPool>();
+		};
+
+		static const auto stackPool{ std::make_unique<StackPool>() };
+		static const auto bitmapPool{ std::make_unique<BitmapPool>() };
+
+		BENCHMARK(capacityName + " slots, locked stack, request and release 64K")
+		{
+			requestReleaseBurst(*stackPool, 65'536U);
+		};
+
+		BENCHMARK(capacityName + " slots, hierarchical bitmap, request and release 64K")
+		{
+			requestReleaseBurst(*bitmapPool, 65'536U);
+		};
+	}
+}
+
+namespace
+{
+	constexpr std::size_t ITEMS_PER_LOOP{ 65'536U };
+
+	// requests and releases ITEMS_PER_LOOP items, burstSize at a time, one by one
+	template <typename Pool>
+	void perItemBurstLoop(Pool& pool, std::size_t burstSize)
+	{
+		std::vector<decltype(pool.request())> items{};
+		items.reserve(burstSize);
+
+		for (std::size_t burst{ 0U }; burst != ITEMS_PER_LOOP / burstSize; ++burst)
+		{
+			for (std::size_t i{ 0U }; i != burstSize; ++i)
+			{
+				items.push_back(pool.request(i));
+			}
+
+			items.clear();
+		}
+	}
+
+	// as perItemBurstLoop(), but every burst is one requestN() and one release of the batch
+	template <typename Pool, typename Batch>
+	void batchedBurstLoop(Pool& pool, Batch& batch, std::size_t burstSize)
+	{
+		for (std::size_t burst{ 0U }; burst != ITEMS_PER_LOOP / burstSize; ++burst)
+		{
+			static_cast<void>(pool.requestN(burstSize, batch, sop::BatchMode::ALL_OR_NOTHING, burst));
+
+			batch.clear();
+		}
+	}
+}
+
+TEST_CASE("per-item and batched bursts", "[benchmark]")
+{
+	static sop::StackfullObjectPool<std::size_t, 1024U, sop::LockedPoolTraits> lockedPool{};
+	static sop::StackfullObjectPool<std::size_t, 1024U, sop::LockFreePoolTraits> lockFreePool{};
+	static sop::PoolBatch<std::size_t, 1024U, sop::LockedPoolTraits> lockedBatch{ lockedPool };
+	static sop::PoolBatch<std::size_t, 1024U, sop::LockFreePoolTraits> lockFreeBatch{ lockFreePool };
+
+	for (const std::size_t burstSize : { 1U, 4U, 16U, 64U, 256U })
+	{
+		BENCHMARK("locked stack, per item, bursts of " + std::to_string(burstSize))
+		{
+			perItemBurstLoop(lockedPool, burstSize);
+		};
+
+		BENCHMARK("locked stack, batched, bursts of " + std::to_string(burstSize))
+		{
+			batchedBurstLoop(lockedPool, lockedBatch, burstSize);
+		};
+
+		BENCHMARK("lock-free stack, per item, bursts of " + std::to_string(burstSize))
+		{
+			perItemBurstLoop(lockFreePool, burstSize);
+		};
+
+		BENCHMARK("lock-free stack, batched, bursts of " + std::to_string(burstSize))
+		{
+			batchedBurstLoop(lockFreePool, lockFreeBatch, burstSize);
+		};
+	}
+}
+
+namespace
+{
+	template <std::size_t SIZE>
+	struct Payload
+	{
+		std::array<std::byte, SIZE> bytes;
+	};
+
+	constexpr std::size_t PAYLOADS_PER_LOOP{ 64U };
+
+	// requests payloads and overwrites each completely, as with a frame received into it
+	template <typename Pool, typename... Init>
+	void overwrittenPayloadLoop(Pool& pool, const std::vector<std::byte>& source, const Init&... init)
+	{
+		for (std::size_t i{ 0U }; i != PAYLOADS_PER_LOOP; ++i)
+		{
+			auto payload = pool.request(init...);
+			std::memcpy(payload->bytes.data(), source.data(), source.size());
+		}
+	}
+
+	template <std::size_t SIZE>
+	void payloadBenchmarks(const std::string& sizeName)
+	{
+		using Pool = sop::StackfullObjectPool<Payload<SIZE>, 4U, sop::HeapPoolTraits>;
+
+		static Pool pool{};
+		static const std::vector<std::byte> source(SIZE, std::byte{ 0x5A });
+
+		BENCHMARK(sizeName + " payload, value-initialized then overwritten")
+		{
+			overwrittenPayloadLoop(pool, source);
+		};
+
+		BENCHMARK(sizeName + " payload, default-initialized then overwritten")
+		{
+			overwrittenPayloadLoop(pool, source, sop::DEFAULT_INIT);
+		};
+	}
+}
+
+TEST_CASE("value- and default-initialized requests by payload size", "[benchmark]")
+{
+	payloadBenchmarks<8U>("8B");
+	payloadBenchmarks<64U>("64B");
+	payloadBenchmarks<512U>("512B");
+	payloadBenchmarks<4096U>("4KB");
+	payloadBenchmarks<65'536U>("64KB");
+}
+
+namespace
+{
+	constexpr std::size_t HELD_ITEMS{ 4096U };
+
+	// fills a queue of items, then releases them all in the order they were requested
+	template <typename Item, typename Request>
+	void heldItemsLoop(std::vector<Item>& items, Request request)
+	{
+		for (std::size_t i{ 0U }; i != HELD_ITEMS; ++i)
+		{
+			items.push_back(request(i));
+		}
+
+		items.clear();
+	}
+}
+
+TEST_CASE("compact and regular items", "[benchmark]")
+{
+	using Item = sop::PoolItem<std::uint64_t, HELD_ITEMS, sop::CompactPoolTraits>;
+	using CompactItem = sop::CompactPoolItem<std::uint64_t, HELD_ITEMS, sop::CompactPoolTraits>;
+
+	static sop::StackfullObjectPool<std::uint64_t, HELD_ITEMS, sop::CompactPoolTraits> pool{};
+	static std::vector<Item> items{};
+	static std::vector<CompactItem> compactItems{};
+
+	items.reserve(HELD_ITEMS);
+	compactItems.reserve(HELD_ITEMS);
+
+	BENCHMARK("regular items (" + std::to_string(sizeof(Item)) + " bytes), hold and release 4K")
+	{
+		heldItemsLoop(items, [](std::size_t i) { return pool.request(std::uint64_t{ i }); });
+	};
+
+	BENCHMARK("compact items (" + std::to_string(sizeof(CompactItem)) + " bytes), hold and release 4K")
+	{
+		heldItemsLoop(compactItems, [](std::size_t i) { return pool.requestCompact(std::uint64_t{ i }); });
+	};
+
+	BENCHMARK("regular items, request/release")
+	{
+		requestReleaseLoop(pool, 1U);
+	};
+
+	BENCHMARK("compact items, request/release")
+	{
+		for (std::size_t i{ 0U }; i != OPS_PER_THREAD; ++i)
+		{
+			auto item = pool.requestCompact(i);
+			++*item;
+		}
+	};
+}
+
+TEST_CASE("visiting every live object", "[benchmark]")
+{
+	constexpr std::size_t CAPACITY{ 1U << 16U };
+
+	using Pool = sop::StackfullObjectPool<std::uint64_t, CAPACITY, sop::LivePoolTraits>;
+
+	static Pool pool{};
+	static std::vector<sop::PoolItem<std::uint64_t, CAPACITY, sop::LivePoolTraits>> items{};
+
+	for (std::size_t i{ 0U }; i != CAPACITY; ++i)
+	{
+		items.push_back(pool.request(std::uint64_t{ i }));
+	}
+
+	// a random half of the objects stays live, listed in the order the pipeline happened to keep them in
+	std::vector<std::size_t> order(CAPACITY);
+	std::iota(order.begin(), order.end(), std::size_t{ 0U });
+	std::shuffle(order.begin(), order.end(), std::mt19937{ 42U });
+
+	std::vector<std::uint64_t*> list{};
+
+	for (std::size_t i{ 0U }; i != CAPACITY; ++i)
+	{
+		if (i < CAPACITY / 2U)
+		{
+			list.push_back(items[order[i]].get());
+		}
+		else
+		{
+			items[order[i]].reset();
+		}
+	}
+
+	BENCHMARK("separate list of the live objects, 32K of 64K slots")
+	{
+		for (std::uint64_t* const obj : list)
+		{
+			++*obj;
+		}
+	};
+
+	BENCHMARK("forEachLive, 32K of 64K slots")
+	{
+		pool.forEachLive([](std::uint64_t& obj) { ++obj; });
+	};
+
+	const std::size_t cores{ std::max(std::thread::hardware_concurrency(), 1U) };
+	WorkerTeam team{ cores - 1U };
+
+	BENCHMARK("forEachLiveParallel on every core, 32K of 64K slots")
+	{
+		pool.forEachLiveParallel(team, cores, [](std::uint64_t& obj) { ++obj; });
+	};
+
+	items.clear();
+}
+
+namespace
+{
+	struct Record
+	{
+		int i;
+		float f;
+		double d;
+	};
+
+	// the same records, either all live or a random half of them
+	template <std::size_t CAPACITY>
+	void layoutBenchmarks(bool halfLive, const std::string& name)
+	{
+		using AosPool = sop::StackfullObjectPool<Record, CAPACITY, sop::LivePoolTraits>;
+		using SoaPool = sop::SoaObjectPool<std::tuple<int, float, double>, CAPACITY, sop::HeapPoolTraits>;
+
+		const auto aosPool{ std::make_unique<AosPool>() };
+		SoaPool soaPool{};
+		std::vector<sop::PoolItem<Record, CAPACITY, sop::LivePoolTraits>> aosItems{};
+		std::vector<typename SoaPool::Item> soaItems{};
+
+		for (std::size_t i{ 0U }; i != CAPACITY; ++i)
+		{
+			aosItems.push_back(aosPool->request(static_cast<int>(i), 1.0f, 1.0));
+			soaItems.push_back(soaPool.request(static_cast<int>(i), 1.0f, 1.0));
+		}
+
+		if (halfLive)
+		{
+			std::vector<std::size_t> order(CAPACITY);
+			std::iota(order.begin(), order.end(), std::size_t{ 0U });
+			std::shuffle(order.begin(), order.end(), std::mt19937{ 42U });
+
+			for (std::size_t i{ CAPACITY / 2U }; i != CAPACITY; ++i)
+			{
+				aosItems[order[i]].reset();
+				soaItems[order[i]].reset();
+			}
+		}
+
+		const float delta{ 0.5f };
+
+		BENCHMARK("AoS, add delta to every live f, " + name)
+		{
+			aosPool->forEachLive([delta](Record& record) { record.f += delta; });
+		};
+
+		BENCHMARK("SoA by runs, add delta to every live f, " + name)
+		{
+			const std::span<float, CAPACITY> f{ soaPool.template column<1U>() };
+
+			soaPool.forEachLiveRun([f, delta](std::size_t first, std::size_t last) {
+				for (std::size_t i{ first }; i != last; ++i)
+				{
+					f[i] += delta;
+				}
+			});
+		};
+
+		BENCHMARK("SoA slot by slot, add delta to every live f, " + name)
+		{
+			const std::span<float, CAPACITY> f{ soaPool.template column<1U>() };
+
+			soaPool.forEachLive([f, delta](std::size_t i) { f[i] += delta; });
+		};
+	}
+}
+
+TEST_CASE("array of structs and struct of arrays layouts", "[benchmark]")
+{
+	layoutBenchmarks<1U << 16U>(false, "64K live");
+	layoutBenchmarks<1U << 16U>(true, "32K of 64K live");
+}
+
+TEST_CASE("large pools", "[benchmark]")
+{
+	largePoolBenchmarks<1U << 20U>("1M");
+	largePoolBenchmarks<1U << 24U>("16M");
+}
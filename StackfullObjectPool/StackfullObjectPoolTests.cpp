@@ -1,8 +1,54 @@
 ﻿#include "StackfullObjectPool.hpp"
+#include "ShardedObjectPool.hpp"
+#include "DynamicObjectPool.hpp"
+#include "ChunkedObjectPool.hpp"
+#include "ReservedObjectPool.hpp"
+#include "SlotMap.hpp"
+#include "SoaObjectPool.hpp"
 
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+
+// lets a test make the OS refuse to commit reserved memory; every other caller gets the real system call
+static std::atomic<bool> failMprotect{ false };
+
+extern "C" int mprotect(void* addr, std::size_t len, int prot) noexcept
+{
+	if (failMprotect.load(std::memory_order_relaxed))
+	{
+		errno = ENOMEM;
+
+		return -1;
+	}
+
+	return static_cast<int>(::syscall(SYS_mprotect, addr, len, prot));
+}
+
 
 struct TrivialSturct
 {
@@ -11,6 +57,190 @@ struct TrivialSturct
 	double d;
 };
 
+struct alignas(64) CacheLineStruct
+{
+	int i;
+	double d;
+};
+
+struct alignas(32) SimdVector
+{
+	float lanes[8];
+};
+
+struct Align32PoolTraits : sop::DefaultPoolTraits
+{
+	static constexpr std::size_t SLOT_ALIGNMENT{ 32U };
+};
+
+struct Stride48PoolTraits : sop::DefaultPoolTraits
+{
+	static constexpr std::size_t SLOT_STRIDE{ 48U };
+};
+
+struct HeapLockFreeTraits : sop::LockFreePoolTraits
+{
+	template <typename Slab>
+	using Storage = sop::HeapStorage<Slab>;
+};
+
+// a secondary allocator which counts its live allocations
+template <typename T>
+struct CountingAllocator
+{
+	using value_type = T;
+
+	static inline std::atomic<int> live{ 0 };
+
+	CountingAllocator() = default;
+
+	template <typename U>
+	CountingAllocator(const CountingAllocator<U>&) noexcept
+	{ }
+
+	T* allocate(std::size_t n)
+	{
+		++live;
+		return std::allocator<T>{}.allocate(n);
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept
+	{
+		--live;
+		std::allocator<T>{}.deallocate(p, n);
+	}
+};
+
+struct CountingOverflowTraits : sop::LockFreePoolTraits
+{
+	template <typename T>
+	using OverflowAllocator = CountingAllocator<T>;
+};
+
+struct IntrusiveMagazineTraits : sop::DefaultPoolTraits
+{
+	template <std::size_t CAPACITY>
+	using FreeList = sop::MagazineCache<sop::IntrusiveStack<CAPACITY>>;
+};
+
+struct CompactLockFreeTraits : sop::LockFreePoolTraits
+{
+	template <typename Slab>
+	using Storage = sop::SizeAlignedStorage<Slab>;
+};
+
+struct LiveOverflowTraits : sop::HeapOverflowPoolTraits
+{
+	template <std::size_t CAPACITY>
+	using LiveMap = sop::LiveBitmap<CAPACITY>;
+};
+
+// Runs the coroutines it's handed one after another on the thread calling run().
+struct LocalScheduler
+{
+	std::deque<std::coroutine_handle<>> ready{};
+
+	void operator()(std::coroutine_handle<> handle) noexcept
+	{
+		ready.push_back(handle);
+	}
+
+	void run()
+	{
+		while (!ready.empty())
+		{
+			std::coroutine_handle<> handle{ ready.front() };
+			ready.pop_front();
+			handle.resume();
+		}
+	}
+
+	// re-queues the awaiting coroutine behind the ready ones
+	auto yield()
+	{
+		struct Yield
+		{
+			LocalScheduler& scheduler;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { scheduler(handle); }
+			void await_resume() const noexcept { }
+		};
+
+		return Yield{ *this };
+	}
+};
+
+// A coroutine which starts right away and frees itself once it's done.
+struct DetachedTask
+{
+	struct promise_type
+	{
+		DetachedTask get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept { }
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+// A coroutine which starts right away and stays suspended at its end until its owner destroys it.
+struct OwnedTask
+{
+	struct promise_type
+	{
+		OwnedTask get_return_object() noexcept { return { std::coroutine_handle<promise_type>::from_promise(*this) }; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() noexcept { }
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+using AsyncPool = sop::StackfullObjectPool<TrivialSturct, 2U, sop::AsyncPoolTraits>;
+
+DetachedTask holdSlot(AsyncPool& pool, LocalScheduler& scheduler, int id, std::deque<sop::PoolItem<TrivialSturct, 2U, sop::AsyncPoolTraits>>& held)
+{
+	held.push_back(co_await pool.asyncRequest(scheduler, id, 0.5f, 0.25));
+}
+
+OwnedTask holdOwnedSlot(AsyncPool& pool, LocalScheduler& scheduler, int id, std::deque<sop::PoolItem<TrivialSturct, 2U, sop::AsyncPoolTraits>>& held)
+{
+	held.push_back(co_await pool.asyncRequest(scheduler, id, 0.5f, 0.25));
+}
+
+DetachedTask useSlotBriefly(AsyncPool& pool, LocalScheduler& scheduler, int id, std::vector<int>& finished)
+{
+	auto item = co_await pool.asyncRequest(scheduler, id, 0.5f, 0.25);
+
+	co_await scheduler.yield();
+
+	finished.push_back(item->i);
+}
+
+struct pool_exhausted
+{ };
+
+struct CustomErrorPolicy
+{
+	static inline int failures{ 0 };
+
+	template <typename Exception, typename... Args>
+	[[noreturn]] static void fail(Args&&...) noexcept(false)
+	{
+		++failures;
+
+		throw pool_exhausted{};
+	}
+};
+
+struct CustomErrorTraits : sop::LockFreePoolTraits
+{
+	using ErrorPolicy = CustomErrorPolicy;
+};
+
 
 TEST_CASE("simple int pool", "[StackfullObjectPool]")
 {
@@ -104,4 +334,2058 @@ TEST_CASE("trivial struct pool", "[StackfullObjectPool]")
 	REQUIRE(trivial3->i == 0);
 	REQUIRE(trivial3->f == 0.0f);
 	REQUIRE(trivial3->d == 0.0);
-}
\ No newline at end of file
+}
+
+TEST_CASE("lock-free int pool", "[StackfullObjectPool][LockFree]")
+{
+	sop::StackfullObjectPool<int, 2U, sop::LockFreePoolTraits> intPool{};
+
+	REQUIRE(intPool.capacity() == 2U);
+	REQUIRE(intPool.size() == 0U);
+	REQUIRE(!intPool.isFull());
+
+	sop::PoolItem<int, 2U, sop::LockFreePoolTraits> pInt1 = intPool.request(1);
+
+	REQUIRE(intPool.size() == 1U);
+	REQUIRE(*pInt1 == 1);
+
+	{
+		auto pInt2 = intPool.request(2);
+
+		REQUIRE(intPool.size() == 2U);
+		REQUIRE(intPool.isFull());
+		REQUIRE(*pInt2 == 2);
+		REQUIRE(pInt1.get() != pInt2.get());
+
+		REQUIRE_THROWS_AS(intPool.request(), sop::max_capacity_exception);
+	}
+
+	REQUIRE(intPool.size() == 1U);
+	REQUIRE(!intPool.isFull());
+
+	auto pInt3 = intPool.request();
+	REQUIRE(*pInt3 == 0);
+	REQUIRE(*pInt1 == 1);
+	REQUIRE(intPool.isFull());
+}
+
+TEMPLATE_TEST_CASE("concurrent request/release", "[StackfullObjectPool][LockFree][Magazine][RemoteFree][PerCpu][Bitmap][Intrusive]", sop::DefaultPoolTraits, sop::LockedPoolTraits, sop::HierarchicalBitmapPoolTraits, sop::IntrusivePoolTraits, sop::LockFreePoolTraits, sop::MagazinePoolTraits, sop::RemoteFreePoolTraits, sop::PerCpuPoolTraits)
+{
+	// leaves room for a full magazine per thread
+	constexpr std::size_t CAPACITY{ 512U };
+	constexpr std::size_t THREADS{ 8U };
+	constexpr std::size_t ITERATIONS{ 20'000U };
+
+	sop::StackfullObjectPool<std::size_t, CAPACITY, TestType> pool{};
+	std::atomic<bool> sharedSlot{ false };
+	std::vector<std::thread> threads{};
+
+	for (std::size_t t{ 0U }; t != THREADS; ++t)
+	{
+		threads.emplace_back([&pool, &sharedSlot, t]()
+			{
+				for (std::size_t i{ 0U }; i != ITERATIONS; ++i)
+				{
+					auto item1 = pool.request(t);
+					auto item2 = pool.request(t);
+
+					// no other thread may be handed the same slots in the meantime
+					std::this_thread::yield();
+
+					if (*item1 != t || *item2 != t || item1.get() == item2.get())
+					{
+						sharedSlot = true;
+					}
+				}
+			});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE(!sharedSlot);
+	REQUIRE(pool.size() == 0U);
+
+	// every slot made it back to the free list exactly once
+	std::vector<sop::PoolItem<std::size_t, CAPACITY, TestType>> items{};
+	for (std::size_t i{ 0U }; i != CAPACITY; ++i)
+	{
+		items.push_back(pool.request(i));
+	}
+
+	REQUIRE(pool.isFull());
+	REQUIRE_THROWS_AS(pool.request(), sop::max_capacity_exception);
+
+	std::vector<std::size_t*> addresses{};
+	for (const auto& item : items)
+	{
+		addresses.push_back(item.get());
+	}
+	std::sort(addresses.begin(), addresses.end());
+	REQUIRE(std::adjacent_find(addresses.cbegin(), addresses.cend()) == addresses.cend());
+}
+
+TEST_CASE("magazine cache pool", "[StackfullObjectPool][Magazine]")
+{
+	sop::StackfullObjectPool<int, 64U, sop::MagazinePoolTraits> intPool{};
+
+	REQUIRE(intPool.size() == 0U);
+
+	{
+		auto pInt1 = intPool.request(1);
+		auto pInt2 = intPool.request(2);
+
+		// the magazine refilled with half a magazine, but only two slots are in use
+		REQUIRE(intPool.size() == 2U);
+		REQUIRE(*pInt1 == 1);
+		REQUIRE(*pInt2 == 2);
+	}
+
+	REQUIRE(intPool.size() == 0U);
+
+	std::vector<sop::PoolItem<int, 64U, sop::MagazinePoolTraits>> items{};
+
+	std::thread{ [&intPool, &items]()
+		{
+			for (int i{ 0 }; i != 40; ++i)
+			{
+				items.push_back(intPool.request(i));
+			}
+
+			// releases the items into this thread's magazine, which goes back to the pool on thread exit
+			while (items.size() != 10U)
+			{
+				items.pop_back();
+			}
+		} }.join();
+
+	REQUIRE(intPool.size() == 10U);
+
+	// the main thread can get hold of every slot that isn't in use
+	for (int i{ 10 }; i != 64; ++i)
+	{
+		items.push_back(intPool.request(i));
+	}
+
+	REQUIRE(intPool.isFull());
+	REQUIRE_THROWS_AS(intPool.request(), sop::max_capacity_exception);
+
+	items.clear();
+	REQUIRE(intPool.size() == 0U);
+}
+
+TEST_CASE("magazine cache steals from other threads' magazines", "[StackfullObjectPool][Magazine]")
+{
+	sop::StackfullObjectPool<int, 64U, sop::MagazinePoolTraits> intPool{};
+
+	std::promise<void> parked{};
+	std::promise<void> done{};
+	std::thread helper{ [&intPool, &parked, doneFuture = done.get_future()]() mutable
+		{
+			{
+				std::vector<sop::PoolItem<int, 64U, sop::MagazinePoolTraits>> items{};
+				for (int i{ 0 }; i != 64; ++i)
+				{
+					items.push_back(intPool.request(i));
+				}
+			}
+
+			// the released slots sit in this thread's magazine and Central, the thread stays alive
+			parked.set_value();
+			doneFuture.wait();
+		} };
+	parked.get_future().wait();
+
+	REQUIRE(intPool.size() == 0U);
+
+	std::vector<sop::PoolItem<int, 64U, sop::MagazinePoolTraits>> items{};
+	for (int i{ 0 }; i != 64; ++i)
+	{
+		items.push_back(intPool.request(i));
+	}
+
+	REQUIRE(intPool.isFull());
+	REQUIRE_THROWS_AS(intPool.request(), sop::max_capacity_exception);
+
+	items.clear();
+	REQUIRE(intPool.size() == 0U);
+
+	done.set_value();
+	helper.join();
+	REQUIRE(intPool.size() == 0U);
+}
+
+TEST_CASE("magazine cache outlived by threads", "[StackfullObjectPool][Magazine]")
+{
+	std::thread{ []()
+		{
+			for (int round{ 0 }; round != 3; ++round)
+			{
+				// a new cache may land on the address of the destroyed one
+				sop::StackfullObjectPool<int, 8U, sop::MagazinePoolTraits> intPool{};
+				auto pInt = intPool.request(round);
+			}
+		} }.join();
+
+	sop::StackfullObjectPool<int, 8U, sop::MagazinePoolTraits> intPool{};
+	{
+		auto pInt = intPool.request(1);
+		REQUIRE(intPool.size() == 1U);
+	}
+	REQUIRE(intPool.size() == 0U);
+}
+
+TEST_CASE("remote-free pool with a releasing consumer thread", "[StackfullObjectPool][RemoteFree]")
+{
+	using Item = sop::PoolItem<int, 4U, sop::RemoteFreePoolTraits>;
+
+	sop::StackfullObjectPool<int, 4U, sop::RemoteFreePoolTraits> intPool{};
+
+	// the main thread requests and so owns the pool, the items are released on another thread
+	std::vector<std::optional<Item>> items(4U);
+	for (int i{ 0 }; i != 4; ++i)
+	{
+		items[static_cast<std::size_t>(i)].emplace(intPool.request(i));
+	}
+
+	REQUIRE(intPool.isFull());
+
+	std::thread{ [&items]()
+		{
+			items[1U].reset();
+			items[3U].reset();
+		} }.join();
+
+	REQUIRE(intPool.size() == 2U);
+
+	// the remotely released slots are picked up by the next requests
+	items[1U].emplace(intPool.request(5));
+	items[3U].emplace(intPool.request(7));
+
+	REQUIRE(intPool.isFull());
+	REQUIRE_THROWS_AS(intPool.request(), sop::max_capacity_exception);
+	REQUIRE(**items[0U] == 0);
+	REQUIRE(**items[1U] == 5);
+	REQUIRE(**items[2U] == 2);
+	REQUIRE(**items[3U] == 7);
+
+	// the owner releases onto its own stack
+	items[2U].reset();
+	REQUIRE(intPool.size() == 3U);
+	items[2U].emplace(intPool.request(9));
+	REQUIRE(**items[2U] == 9);
+
+	// size() may be read from any thread while remote releases and the owner's drains race it, and never underflows
+	items.clear();
+	std::atomic<bool> done{ false };
+	std::atomic<bool> inRange{ true };
+	std::jthread monitor{ [&]()
+		{
+			while (!done.load())
+			{
+				inRange = inRange && intPool.size() <= intPool.capacity();
+			}
+		} };
+
+	for (int round{ 0 }; round != 200; ++round)
+	{
+		std::vector<std::optional<Item>> batch(4U);
+		for (std::optional<Item>& item : batch)
+		{
+			item.emplace(intPool.request(round));
+		}
+
+		std::thread{ [&batch]() { batch.clear(); } }.join();
+	}
+
+	done = true;
+	monitor.join();
+	REQUIRE(inRange.load());
+	REQUIRE(intPool.size() == 0U);
+}
+
+TEST_CASE("per-CPU cache pool", "[StackfullObjectPool][PerCpu]")
+{
+	using Item = sop::PoolItem<int, 48U, sop::PerCpuPoolTraits>;
+
+	sop::StackfullObjectPool<int, 48U, sop::PerCpuPoolTraits> intPool{};
+	std::vector<Item> items{};
+
+	for (int i{ 0 }; i != 40; ++i)
+	{
+		items.push_back(intPool.request(i));
+	}
+
+	REQUIRE(intPool.size() == 40U);
+
+	// park released slots in the per-CPU caches, possibly of different CPUs
+	std::thread{ [&items]()
+		{
+			while (items.size() != 8U)
+			{
+				items.pop_back();
+			}
+		} }.join();
+
+	REQUIRE(intPool.size() == 8U);
+
+	// cached slots are stolen back once Central runs dry, so the whole capacity stays usable
+	for (int i{ 8 }; i != 48; ++i)
+	{
+		items.push_back(intPool.request(i));
+	}
+
+	REQUIRE(intPool.isFull());
+	REQUIRE_THROWS_AS(intPool.request(), sop::max_capacity_exception);
+
+	for (int i{ 0 }; i != 48; ++i)
+	{
+		REQUIRE(*items[static_cast<std::size_t>(i)] == i);
+	}
+
+	items.clear();
+	REQUIRE(intPool.size() == 0U);
+}
+
+TEST_CASE("small pools default to an atomic bitmap", "[StackfullObjectPool][Bitmap]")
+{
+	STATIC_REQUIRE(std::is_same_v<sop::StackfullObjectPool<int, 512U>::FreeList, sop::AtomicBitmap<512U>>);
+	STATIC_REQUIRE(std::is_same_v<sop::StackfullObjectPool<int, 513U>::FreeList, sop::LockedStack<513U>>);
+	STATIC_REQUIRE(sizeof(sop::AtomicBitmap<64U>) == sizeof(std::uint64_t));
+
+	// spans two words, the last one only partially
+	sop::StackfullObjectPool<int, 70U> intPool{};
+	std::vector<sop::PoolItem<int, 70U>> items{};
+
+	for (int i{ 0 }; i != 70; ++i)
+	{
+		items.push_back(intPool.request(i));
+	}
+
+	REQUIRE(intPool.isFull());
+	REQUIRE_THROWS_AS(intPool.request(), sop::max_capacity_exception);
+
+	// slots are handed out lowest address first
+	for (std::size_t i{ 1U }; i != items.size(); ++i)
+	{
+		REQUIRE(items[i].get() == items[i - 1U].get() + 1);
+	}
+
+	int* const freed{ items[66U].get() };
+	items[66U].reset();
+
+	REQUIRE(intPool.size() == 69U);
+
+	auto pInt = intPool.request(100);
+	REQUIRE(pInt.get() == freed);
+	REQUIRE(intPool.isFull());
+}
+
+TEST_CASE("atomic bitmap bulk acquire and release", "[FreeList][Bitmap]")
+{
+	sop::AtomicBitmap<70U> bitmap{};
+	std::array<std::size_t, 60U> indices{};
+
+	REQUIRE(bitmap.acquire(std::span{ indices }) == 60U);
+	REQUIRE(bitmap.size() == 60U);
+
+	for (std::size_t i{ 0U }; i != indices.size(); ++i)
+	{
+		REQUIRE(indices[i] == i);
+	}
+
+	// only the ten slots that are left can be handed out, across the word boundary
+	REQUIRE(bitmap.acquire(std::span{ indices }) == 10U);
+	REQUIRE(indices[0U] == 60U);
+	REQUIRE(indices[9U] == 69U);
+	REQUIRE(bitmap.size() == 70U);
+
+	bitmap.release(std::span<const std::size_t>{ indices.data(), 10U });
+	REQUIRE(bitmap.size() == 60U);
+
+	std::size_t index{};
+	REQUIRE(bitmap.acquire(index));
+	REQUIRE(index == 60U);
+}
+
+TEST_CASE("hierarchical bitmap hands out the lowest open slot", "[FreeList][Bitmap]")
+{
+	// three top words, the last leaf, middle and top words only partially used
+	constexpr std::size_t CAPACITY{ 2U * 64U * 64U * 64U + 64U * 64U + 3U };
+
+	STATIC_REQUIRE(sizeof(sop::HierarchicalBitmap<CAPACITY>) < CAPACITY / 7U);
+
+	auto bitmap = std::make_unique<sop::HierarchicalBitmap<CAPACITY>>();
+	std::size_t index{};
+	bool inOrder{ true };
+
+	for (std::size_t i{ 0U }; i != CAPACITY; ++i)
+	{
+		inOrder = inOrder && bitmap->acquire(index) && index == i;
+	}
+
+	REQUIRE(inOrder);
+	REQUIRE(bitmap->size() == CAPACITY);
+	REQUIRE(!bitmap->acquire(index));
+
+	for (const std::size_t freed : { CAPACITY - 1U, std::size_t{ 300'000U }, std::size_t{ 70U }, std::size_t{ 4096U } })
+	{
+		bitmap->release(freed);
+	}
+
+	REQUIRE(bitmap->size() == CAPACITY - 4U);
+
+	for (const std::size_t expected : { std::size_t{ 70U }, std::size_t{ 4096U }, std::size_t{ 300'000U }, CAPACITY - 1U })
+	{
+		REQUIRE(bitmap->acquire(index));
+		REQUIRE(index == expected);
+	}
+
+	REQUIRE(!bitmap->acquire(index));
+}
+
+TEST_CASE("hierarchical bitmap pool", "[StackfullObjectPool][Bitmap]")
+{
+	using Pool = sop::StackfullObjectPool<TrivialSturct, 5000U, sop::HierarchicalBitmapPoolTraits>;
+
+	auto pool = std::make_unique<Pool>();
+	std::vector<sop::PoolItem<TrivialSturct, 5000U, sop::HierarchicalBitmapPoolTraits>> items{};
+
+	for (int i{ 0 }; i != 5000; ++i)
+	{
+		items.push_back(pool->request(i, 0.5f, 1.5));
+	}
+
+	REQUIRE(pool->isFull());
+	REQUIRE_THROWS_AS(pool->request(), sop::max_capacity_exception);
+	REQUIRE(items[4999U]->i == 4999);
+
+	TrivialSturct* const freed{ items[1234U].get() };
+	items[1234U].reset();
+	items[4321U].reset();
+
+	REQUIRE(pool->size() == 4998U);
+
+	auto trivial = pool->request(-1, 0.0f, 0.0);
+	REQUIRE(trivial.get() == freed);
+}
+
+TEST_CASE("intrusive free list lives in the open slots", "[StackfullObjectPool][Intrusive]")
+{
+	using Pool = sop::StackfullObjectPool<std::uint64_t, 256U, sop::IntrusivePoolTraits>;
+
+	// no per-slot bookkeeping next to the slots themselves, only the couple of lines holding the free list's head
+	STATIC_REQUIRE(sizeof(Pool) <= 256U * sizeof(std::uint64_t) + 2U * sop::CACHE_LINE_SIZE);
+	STATIC_REQUIRE(sizeof(Pool) < sizeof(sop::StackfullObjectPool<std::uint64_t, 256U, sop::LockedPoolTraits>));
+
+	Pool pool{};
+	std::vector<sop::PoolItem<std::uint64_t, 256U, sop::IntrusivePoolTraits>> items{};
+
+	for (std::uint64_t i{ 0U }; i != 256U; ++i)
+	{
+		items.push_back(pool.request(i));
+	}
+
+	REQUIRE(pool.isFull());
+	REQUIRE_THROWS_AS(pool.request(), sop::max_capacity_exception);
+
+	std::uint64_t* const freed1{ items[17U].get() };
+	std::uint64_t* const freed2{ items[200U].get() };
+	items[17U].reset();
+	items[200U].reset();
+
+	REQUIRE(pool.size() == 254U);
+
+	// released slots are reused last in, first out, and the link is overwritten by the new object
+	auto item1 = pool.request(1000U);
+	auto item2 = pool.request(2000U);
+
+	REQUIRE(item1.get() == freed2);
+	REQUIRE(item2.get() == freed1);
+	REQUIRE(*item1 == 1000U);
+	REQUIRE(*item2 == 2000U);
+	REQUIRE(*items[18U] == 18U);
+	REQUIRE(pool.isFull());
+}
+
+TEST_CASE("intrusive free list links fit single byte slots", "[StackfullObjectPool][Intrusive]")
+{
+	STATIC_REQUIRE(std::is_same_v<sop::IntrusiveStack<255U>::Link, std::uint8_t>);
+	STATIC_REQUIRE(std::is_same_v<sop::IntrusiveStack<256U>::Link, std::uint16_t>);
+
+	sop::StackfullObjectPool<char, 100U, sop::IntrusivePoolTraits> charPool{};
+
+	{
+		auto c1 = charPool.request('a');
+		auto c2 = charPool.request('b');
+		REQUIRE(*c1 == 'a');
+		REQUIRE(*c2 == 'b');
+	}
+
+	auto c3 = charPool.request('c');
+	REQUIRE(*c3 == 'c');
+	REQUIRE(charPool.size() == 1U);
+}
+
+TEST_CASE("intrusive free list behind caches and shards", "[StackfullObjectPool][Intrusive]")
+{
+	sop::StackfullObjectPool<int, 64U, IntrusiveMagazineTraits> magazinePool{};
+	sop::ShardedObjectPool<int, 64U, 4U, sop::IntrusivePoolTraits> shardedPool{};
+
+	std::vector<sop::PoolItem<int, 64U, IntrusiveMagazineTraits>> magazineItems{};
+	std::vector<sop::ShardedPoolItem<int, 64U, 4U, sop::IntrusivePoolTraits>> shardedItems{};
+
+	for (int round{ 0 }; round != 2; ++round)
+	{
+		for (int i{ 0 }; i != 64; ++i)
+		{
+			magazineItems.push_back(magazinePool.request(i));
+			shardedItems.push_back(shardedPool.request(i));
+		}
+
+		REQUIRE(magazinePool.isFull());
+		REQUIRE(shardedPool.isFull());
+
+		magazineItems.clear();
+		shardedItems.clear();
+
+		REQUIRE(magazinePool.size() == 0U);
+		REQUIRE(shardedPool.size() == 0U);
+	}
+}
+
+TEST_CASE("free list indices are as narrow as CAPACITY allows", "[FreeList]")
+{
+	STATIC_REQUIRE(std::is_same_v<sop::IndexFor<256U>, std::uint8_t>);
+	STATIC_REQUIRE(std::is_same_v<sop::IndexFor<257U>, std::uint16_t>);
+	STATIC_REQUIRE(std::is_same_v<sop::IndexFor<65'536U>, std::uint16_t>);
+	STATIC_REQUIRE(std::is_same_v<sop::IndexFor<65'537U>, std::uint32_t>);
+	STATIC_REQUIRE(std::is_same_v<sop::IndexFor<0x1'0000'0001U>, std::uint64_t>);
+
+	// a 256 slot pool of int spends a byte per slot on its stack rather than eight
+	STATIC_REQUIRE(sizeof(sop::LockedStack<256U>) < 256U + 64U);
+	STATIC_REQUIRE(sizeof(sop::StackfullObjectPool<int, 256U, sop::LockedPoolTraits>) < 256U * (sizeof(int) + 1U) + 128U);
+
+	sop::StackfullObjectPool<int, 256U, sop::LockedPoolTraits> intPool{};
+	std::vector<sop::PoolItem<int, 256U, sop::LockedPoolTraits>> items{};
+
+	for (int i{ 0 }; i != 256; ++i)
+	{
+		items.push_back(intPool.request(i));
+	}
+
+	REQUIRE(intPool.isFull());
+	REQUIRE(*items[255U] == 255);
+
+	int* const last{ items[255U].get() };
+	items.pop_back();
+
+	auto pInt = intPool.request(-1);
+	REQUIRE(pInt.get() == last);
+}
+
+TEST_CASE("slots honour over-aligned types", "[StackfullObjectPool][Alignment]")
+{
+	STATIC_REQUIRE(sop::SlotLayout<CacheLineStruct, sop::DefaultPoolTraits>::SIZE == 64U);
+	STATIC_REQUIRE(sop::SlotLayout<SimdVector, sop::DefaultPoolTraits>::SIZE == 32U);
+	STATIC_REQUIRE(sop::SlotLayout<int, sop::DefaultPoolTraits>::SIZE == sizeof(int));
+
+	// a heap allocated pool goes through the aligned operator new
+	auto cacheLinePool = std::make_unique<sop::StackfullObjectPool<CacheLineStruct, 8U>>();
+	std::vector<sop::PoolItem<CacheLineStruct, 8U>> items{};
+
+	for (int i{ 0 }; i != 8; ++i)
+	{
+		items.push_back(cacheLinePool->request(i, i * 0.5));
+	}
+
+	for (int i{ 0 }; i != 8; ++i)
+	{
+		REQUIRE(reinterpret_cast<std::uintptr_t>(items[static_cast<std::size_t>(i)].get()) % 64U == 0U);
+		REQUIRE(items[static_cast<std::size_t>(i)]->i == i);
+	}
+
+	sop::StackfullObjectPool<SimdVector, 4U, sop::LockedPoolTraits> simdPool{};
+	auto pVec1 = simdPool.request();
+	auto pVec2 = simdPool.request(SimdVector{ { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f } });
+
+	REQUIRE(reinterpret_cast<std::uintptr_t>(pVec1.get()) % 32U == 0U);
+	REQUIRE(reinterpret_cast<std::uintptr_t>(pVec2.get()) % 32U == 0U);
+	REQUIRE(pVec2->lanes[7] == 8.0f);
+
+	items.pop_back();
+	REQUIRE(cacheLinePool->size() == 7U);
+}
+
+TEST_CASE("slot alignment can be raised for SIMD payloads", "[StackfullObjectPool][ShardedObjectPool][Alignment]")
+{
+	// float slots padded out to 32 bytes
+	STATIC_REQUIRE(sop::SlotLayout<float, Align32PoolTraits>::ALIGNMENT == 32U);
+	STATIC_REQUIRE(sop::SlotLayout<float, Align32PoolTraits>::SIZE == 32U);
+	STATIC_REQUIRE(sop::SlotLayout<CacheLineStruct, Align32PoolTraits>::ALIGNMENT == 64U);
+
+	sop::StackfullObjectPool<float, 16U, Align32PoolTraits> floatPool{};
+	sop::ShardedObjectPool<float, 16U, 4U, Align32PoolTraits> shardedPool{};
+	std::vector<sop::PoolItem<float, 16U, Align32PoolTraits>> items{};
+	std::vector<sop::ShardedPoolItem<float, 16U, 4U, Align32PoolTraits>> shardedItems{};
+
+	for (int i{ 0 }; i != 16; ++i)
+	{
+		items.push_back(floatPool.request(static_cast<float>(i)));
+		shardedItems.push_back(shardedPool.request(static_cast<float>(i)));
+	}
+
+	REQUIRE(floatPool.isFull());
+	REQUIRE(shardedPool.isFull());
+
+	bool aligned{ true };
+
+	for (std::size_t i{ 0U }; i != 16U; ++i)
+	{
+		aligned = aligned && reinterpret_cast<std::uintptr_t>(items[i].get()) % 32U == 0U && *items[i] == static_cast<float>(i);
+		aligned = aligned && reinterpret_cast<std::uintptr_t>(shardedItems[i].get()) % 32U == 0U && *shardedItems[i] == static_cast<float>(i);
+	}
+
+	REQUIRE(aligned);
+
+	items.clear();
+	shardedItems.clear();
+
+	REQUIRE(floatPool.size() == 0U);
+	REQUIRE(shardedPool.size() == 0U);
+}
+
+TEST_CASE("padded slots keep neighbouring objects off each other's cache lines", "[StackfullObjectPool][Alignment]")
+{
+	STATIC_REQUIRE(sop::SlotLayout<TrivialSturct, sop::PaddedPoolTraits>::SIZE == sop::CACHE_LINE_SIZE);
+	STATIC_REQUIRE(sop::SlotLayout<CacheLineStruct, sop::PaddedPoolTraits>::SIZE == sop::CACHE_LINE_SIZE);
+	STATIC_REQUIRE(sop::SlotLayout<std::uint64_t, Stride48PoolTraits>::SIZE == 48U);
+	STATIC_REQUIRE(sop::SlotLayout<std::uint64_t, Stride48PoolTraits>::ALIGNMENT == alignof(std::uint64_t));
+	STATIC_REQUIRE(sop::SlotLayout<TrivialSturct, Stride48PoolTraits>::SIZE == 48U);
+
+	// the slots take a line each, and the bookkeeping starts on a line of its own after them
+	STATIC_REQUIRE(sizeof(sop::StackfullObjectPool<TrivialSturct, 8U, sop::PaddedPoolTraits>) >= 9U * sop::CACHE_LINE_SIZE);
+
+	sop::StackfullObjectPool<TrivialSturct, 8U, sop::PaddedPoolTraits> paddedPool{};
+	sop::StackfullObjectPool<std::uint64_t, 8U, Stride48PoolTraits> stridedPool{};
+	std::vector<sop::PoolItem<TrivialSturct, 8U, sop::PaddedPoolTraits>> items{};
+	std::vector<sop::PoolItem<std::uint64_t, 8U, Stride48PoolTraits>> stridedItems{};
+
+	for (int i{ 0 }; i != 8; ++i)
+	{
+		items.push_back(paddedPool.request(i, 0.5f, 0.25));
+		stridedItems.push_back(stridedPool.request(static_cast<std::uint64_t>(i)));
+	}
+
+	REQUIRE(paddedPool.isFull());
+	REQUIRE(stridedPool.isFull());
+
+	std::vector<std::uintptr_t> lines{};
+	std::vector<std::uintptr_t> strided{};
+
+	for (std::size_t i{ 0U }; i != 8U; ++i)
+	{
+		REQUIRE(items[i]->i == static_cast<int>(i));
+		REQUIRE(*stridedItems[i] == i);
+		lines.push_back(reinterpret_cast<std::uintptr_t>(items[i].get()));
+		strided.push_back(reinterpret_cast<std::uintptr_t>(stridedItems[i].get()));
+	}
+
+	std::sort(lines.begin(), lines.end());
+	std::sort(strided.begin(), strided.end());
+
+	for (std::size_t i{ 1U }; i != 8U; ++i)
+	{
+		REQUIRE(lines[i] % sop::CACHE_LINE_SIZE == 0U);
+		REQUIRE(lines[i] - lines[i - 1U] == sop::CACHE_LINE_SIZE);
+		REQUIRE(strided[i] - strided[i - 1U] == 48U);
+	}
+
+	items.clear();
+	stridedItems.clear();
+
+	REQUIRE(paddedPool.size() == 0U);
+	REQUIRE(stridedPool.size() == 0U);
+}
+
+TEST_CASE("large pools keep their slots outside the pool object", "[StackfullObjectPool][ShardedObjectPool][Storage]")
+{
+	constexpr std::size_t CAPACITY{ 1U << 20U };
+
+	// a single pointer, rather than megabytes on the stack
+	STATIC_REQUIRE(sizeof(sop::StackfullObjectPool<TrivialSturct, CAPACITY, sop::HeapPoolTraits>) == sizeof(void*));
+	STATIC_REQUIRE(sizeof(sop::StackfullObjectPool<TrivialSturct, CAPACITY, sop::MmapPoolTraits>) == sizeof(void*));
+	STATIC_REQUIRE(sizeof(sop::ShardedObjectPool<TrivialSturct, CAPACITY, 4U, sop::HeapPoolTraits>) == sizeof(void*));
+	STATIC_REQUIRE(!std::is_nothrow_default_constructible_v<sop::StackfullObjectPool<TrivialSturct, CAPACITY, sop::HeapPoolTraits>>);
+	STATIC_REQUIRE(std::is_nothrow_default_constructible_v<sop::StackfullObjectPool<TrivialSturct, 8U>>);
+
+	sop::StackfullObjectPool<TrivialSturct, CAPACITY, sop::HeapPoolTraits> heapPool{};
+	sop::StackfullObjectPool<TrivialSturct, CAPACITY, sop::MmapPoolTraits> mmapPool{};
+	sop::StackfullObjectPool<CacheLineStruct, 1024U, HeapLockFreeTraits> alignedPool{};
+	sop::ShardedObjectPool<TrivialSturct, CAPACITY, 4U, sop::HeapPoolTraits> shardedPool{};
+
+	REQUIRE(heapPool.capacity() == CAPACITY);
+	REQUIRE(mmapPool.size() == 0U);
+
+	std::vector<sop::PoolItem<TrivialSturct, CAPACITY, sop::HeapPoolTraits>> heapItems{};
+	std::vector<sop::PoolItem<TrivialSturct, CAPACITY, sop::MmapPoolTraits>> mmapItems{};
+	std::vector<sop::ShardedPoolItem<TrivialSturct, CAPACITY, 4U, sop::HeapPoolTraits>> shardedItems{};
+
+	for (int i{ 0 }; i != 1000; ++i)
+	{
+		heapItems.push_back(heapPool.request(i, 1.0f, 2.0));
+		mmapItems.push_back(mmapPool.request(i, 1.0f, 2.0));
+		shardedItems.push_back(shardedPool.request(i, 1.0f, 2.0));
+	}
+
+	REQUIRE(heapPool.size() == 1000U);
+	REQUIRE(mmapPool.size() == 1000U);
+	REQUIRE(shardedPool.size() == 1000U);
+	REQUIRE(heapItems[999U]->i == 999);
+	REQUIRE(mmapItems[999U]->i == 999);
+	REQUIRE(shardedItems[999U]->i == 999);
+
+	auto aligned = alignedPool.request(7, 0.5);
+	REQUIRE(reinterpret_cast<std::uintptr_t>(aligned.get()) % 64U == 0U);
+	REQUIRE(aligned->i == 7);
+
+	TrivialSturct* const freed{ mmapItems[500U].get() };
+	mmapItems[500U].reset();
+
+	auto reused = mmapPool.request(-1, 0.0f, 0.0);
+	REQUIRE(reused.get() == freed);
+
+	heapItems.clear();
+	mmapItems.clear();
+	shardedItems.clear();
+	reused.reset();
+
+	REQUIRE(heapPool.size() == 0U);
+	REQUIRE(mmapPool.size() == 0U);
+	REQUIRE(shardedPool.size() == 0U);
+}
+
+TEMPLATE_TEST_CASE("capacity given at run time", "[DynamicObjectPool]", sop::DefaultPoolTraits, sop::LockFreePoolTraits, sop::MagazinePoolTraits)
+{
+	// e.g. read from a config file
+	const std::size_t capacity{ GENERATE(0U, 1U, 100U, 5000U) };
+
+	sop::DynamicObjectPool<TrivialSturct, TestType> pool{ capacity };
+
+	REQUIRE(pool.capacity() == capacity);
+	REQUIRE(pool.size() == 0U);
+	REQUIRE(pool.isFull() == (capacity == 0U));
+
+	std::vector<sop::DynamicPoolItem<TrivialSturct, TestType>> items{};
+	bool filled{ true };
+
+	for (std::size_t i{ 0U }; i != capacity; ++i)
+	{
+		items.push_back(pool.request(static_cast<int>(i), 1.0f, 2.0));
+		filled = filled && items.back()->i == static_cast<int>(i);
+	}
+
+	REQUIRE(filled);
+	REQUIRE(pool.size() == capacity);
+	REQUIRE(pool.isFull());
+
+	REQUIRE_THROWS_AS(pool.request(), sop::max_capacity_exception);
+
+	if (capacity != 0U)
+	{
+		TrivialSturct* const freed{ items.back().get() };
+		items.pop_back();
+		REQUIRE(!pool.isFull());
+
+		auto trivial = pool.request(-1, 0.0f, 0.0);
+		REQUIRE(trivial.get() == freed);
+		REQUIRE(trivial->i == -1);
+	}
+}
+
+TEST_CASE("run time capacity pool", "[DynamicObjectPool]")
+{
+	// one instantiation serves every capacity
+	STATIC_REQUIRE(std::is_same_v<sop::DynamicPoolItem<int>, decltype(std::declval<sop::DynamicObjectPool<int>&>().request())>);
+	STATIC_REQUIRE(sizeof(sop::DynamicObjectPool<int>) < 256U);
+
+	sop::DynamicObjectPool<CacheLineStruct, sop::LockFreePoolTraits> alignedPool{ 3U };
+	auto pAligned1 = alignedPool.request(1, 1.5);
+	auto pAligned2 = alignedPool.request(2, 2.5);
+
+	REQUIRE(reinterpret_cast<std::uintptr_t>(pAligned1.get()) % 64U == 0U);
+	REQUIRE(reinterpret_cast<std::uintptr_t>(pAligned2.get()) % 64U == 0U);
+	REQUIRE(pAligned2->d == 2.5);
+
+	sop::DynamicObjectPool<std::uint64_t, sop::LockFreePoolTraits> counters{ 64U };
+	std::vector<std::thread> threads{};
+	std::atomic<bool> failed{ false };
+
+	for (int t{ 0 }; t != 4; ++t)
+	{
+		threads.emplace_back([&counters, &failed]()
+			{
+				for (std::uint64_t i{ 0U }; i != 10'000U; ++i)
+				{
+					auto counter = counters.request(i);
+					++*counter;
+
+					if (*counter != i + 1U)
+					{
+						failed = true;
+					}
+				}
+			});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE(!failed);
+	REQUIRE(counters.size() == 0U);
+
+	REQUIRE_THROWS_AS(sop::TreiberStack<sop::DYNAMIC_CAPACITY>{ std::size_t{ 1U } << 32U }, std::length_error);
+}
+
+TEMPLATE_TEST_CASE("chunked pool grows instead of throwing", "[ChunkedObjectPool]", sop::DefaultPoolTraits, sop::LockFreePoolTraits, sop::IntrusivePoolTraits, sop::PaddedPoolTraits)
+{
+	sop::ChunkedObjectPool<TrivialSturct, 64U, TestType> pool{ 4U };
+
+	REQUIRE(pool.capacity() == 0U);
+	REQUIRE(pool.maxCapacity() == 256U);
+	REQUIRE(pool.size() == 0U);
+
+	std::vector<sop::ChunkedPoolItem<TrivialSturct, 64U, TestType>> items{};
+	std::vector<TrivialSturct*> addresses{};
+	bool grown{ true };
+
+	for (int i{ 0 }; i != 256; ++i)
+	{
+		items.push_back(pool.request(i, 0.5f, 0.25));
+		addresses.push_back(items.back().get());
+		grown = grown && pool.capacity() == (static_cast<std::size_t>(i) / 64U + 1U) * 64U;
+	}
+
+	REQUIRE(grown);
+	REQUIRE(pool.isFull());
+	REQUIRE_THROWS_AS(pool.request(), sop::max_capacity_exception);
+
+	// growing never moved the objects already handed out
+	bool stable{ true };
+
+	for (std::size_t i{ 0U }; i != 256U; ++i)
+	{
+		stable = stable && items[i].get() == addresses[i] && items[i]->i == static_cast<int>(i);
+	}
+
+	REQUIRE(stable);
+
+	// a slot freed in the first chunk is found again
+	TrivialSturct* const freed{ items[10U].get() };
+	items[10U].reset();
+	REQUIRE(pool.size() == 255U);
+
+	auto trivial = pool.request(-1, 0.0f, 0.0);
+	REQUIRE(trivial.get() == freed);
+
+	trivial.reset();
+	items.clear();
+	REQUIRE(pool.size() == 0U);
+	REQUIRE(pool.capacity() == 256U);
+}
+
+TEMPLATE_TEST_CASE("chunked pool trims empty chunks", "[ChunkedObjectPool]", sop::DefaultPoolTraits, sop::MagazinePoolTraits)
+{
+	sop::ChunkedObjectPool<std::uint64_t, 1024U, TestType> pool{ 3U };
+	std::vector<sop::ChunkedPoolItem<std::uint64_t, 1024U, TestType>> items{};
+
+	for (std::uint64_t i{ 0U }; i != 2048U; ++i)
+	{
+		items.push_back(pool.request(i));
+	}
+
+	REQUIRE(pool.capacity() == 2048U);
+	REQUIRE(pool.trim() == 0U);
+
+	// empty the second chunk, keep a single object alive in the first
+	while (items.size() != 1U)
+	{
+		items.pop_back();
+	}
+
+	REQUIRE(pool.trim() == 1U);
+	REQUIRE(pool.capacity() == 1024U);
+	REQUIRE(pool.size() == 1U);
+	REQUIRE(*items[0U] == 0U);
+
+	// the trimmed chunk is put back in service before a third chunk is added
+	for (std::uint64_t i{ 1U }; i != 2048U; ++i)
+	{
+		items.push_back(pool.request(i));
+	}
+
+	REQUIRE(pool.capacity() == 2048U);
+	REQUIRE(pool.size() == 2048U);
+
+	bool intact{ true };
+
+	for (std::uint64_t i{ 0U }; i != 2048U; ++i)
+	{
+		intact = intact && *items[i] == i;
+	}
+
+	REQUIRE(intact);
+
+	items.clear();
+	REQUIRE(pool.trim() == 2U);
+	REQUIRE(pool.capacity() == 0U);
+	REQUIRE(pool.size() == 0U);
+
+	auto revived = pool.request(std::uint64_t{ 17U });
+	REQUIRE(*revived == 17U);
+	REQUIRE(pool.capacity() == 1024U);
+}
+
+TEST_CASE("chunked pool trims in the background and under concurrent load", "[ChunkedObjectPool]")
+{
+	sop::ChunkedObjectPool<std::uint64_t, 32U, sop::LockFreePoolTraits> pool{ 8U, std::chrono::milliseconds{ 1 } };
+
+	std::vector<std::thread> threads{};
+	std::atomic<bool> failed{ false };
+
+	for (int t{ 0 }; t != 4; ++t)
+	{
+		threads.emplace_back([&pool, &failed]()
+			{
+				std::vector<sop::ChunkedPoolItem<std::uint64_t, 32U, sop::LockFreePoolTraits>> held{};
+
+				for (std::uint64_t i{ 0U }; i != 5'000U; ++i)
+				{
+					held.push_back(pool.request(i));
+
+					if (held.size() == 48U)
+					{
+						for (std::uint64_t j{ 0U }; j != held.size(); ++j)
+						{
+							failed = failed || *held[j] != i - held.size() + 1U + j;
+						}
+
+						held.clear();
+					}
+				}
+			});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE(!failed);
+	REQUIRE(pool.size() == 0U);
+
+	// once idle, every chunk is trimmed by the background thread
+	const auto deadline{ std::chrono::steady_clock::now() + std::chrono::seconds{ 10 } };
+
+	while (pool.capacity() != 0U && std::chrono::steady_clock::now() < deadline)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+	}
+
+	REQUIRE(pool.capacity() == 0U);
+}
+
+TEST_CASE("reserved pool commits its range as it grows", "[ReservedObjectPool]")
+{
+	using Pool = sop::ReservedObjectPool<std::uint64_t, 1U << 26U>;
+
+	constexpr std::size_t GRANULE_SLOTS{ Pool::COMMIT_GRANULE / sizeof(std::uint64_t) };
+
+	// half a GiB of address space, but only the slots handed out so far are backed by memory
+	STATIC_REQUIRE(sizeof(Pool) <= 4U * sop::CACHE_LINE_SIZE);
+
+	Pool pool{};
+
+	REQUIRE(pool.capacity() == 1U << 26U);
+	REQUIRE(pool.committedCapacity() == 0U);
+
+	std::vector<sop::ReservedPoolItem<std::uint64_t, 1U << 26U>> items{};
+	bool contiguous{ true };
+
+	for (std::uint64_t i{ 0U }; i != 3U * GRANULE_SLOTS + 1U; ++i)
+	{
+		items.push_back(pool.request(i));
+		contiguous = contiguous && items.back().get() == items.front().get() + i;
+	}
+
+	REQUIRE(contiguous);
+	REQUIRE(pool.size() == 3U * GRANULE_SLOTS + 1U);
+	REQUIRE(pool.committedCapacity() >= 3U * GRANULE_SLOTS + 1U);
+	REQUIRE(pool.committedCapacity() <= 3U * GRANULE_SLOTS + GRANULE_SLOTS * 4U);
+	REQUIRE(*items.back() == 3U * GRANULE_SLOTS);
+
+	std::uint64_t* const freed{ items[42U].get() };
+	items[42U].reset();
+
+	auto reused = pool.request(std::uint64_t{ 17U });
+	REQUIRE(reused.get() == freed);
+	REQUIRE(*items[41U] == 41U);
+	REQUIRE(*items[43U] == 43U);
+
+	sop::ReservedObjectPool<TrivialSturct, 3U, sop::LockedPoolTraits> smallPool{};
+	auto pTrivial1 = smallPool.request(1, 1.0f, 1.0);
+	auto pTrivial2 = smallPool.request(2, 2.0f, 2.0);
+	auto pTrivial3 = smallPool.request(3, 3.0f, 3.0);
+
+	REQUIRE(smallPool.isFull());
+	REQUIRE_THROWS_AS(smallPool.request(), sop::max_capacity_exception);
+	REQUIRE(pTrivial3->d == 3.0);
+}
+
+TEST_CASE("reserved pool survives a refused commit", "[ReservedObjectPool]")
+{
+	constexpr std::size_t GRANULE_SLOTS{ sop::ReservedObjectPool<std::uint64_t, 1U>::COMMIT_GRANULE / sizeof(std::uint64_t) };
+	constexpr std::size_t CAPACITY{ GRANULE_SLOTS + 2U };
+
+	sop::ReservedObjectPool<std::uint64_t, CAPACITY> pool{};
+	std::vector<sop::ReservedPoolItem<std::uint64_t, CAPACITY>> items{};
+
+	for (std::uint64_t i{ 0U }; i != GRANULE_SLOTS; ++i)
+	{
+		items.push_back(pool.request(i));
+	}
+
+	REQUIRE(pool.committedCapacity() == GRANULE_SLOTS);
+
+	// both uncommitted slots are refused, which drains the free list without touching their memory
+	failMprotect.store(true);
+	REQUIRE_THROWS_AS(pool.request(std::uint64_t{ 0U }), std::bad_alloc);
+	REQUIRE_FALSE(pool.tryRequest(std::uint64_t{ 0U }).has_value());
+	failMprotect.store(false);
+
+	REQUIRE(pool.size() == GRANULE_SLOTS);
+	REQUIRE_FALSE(pool.isFull());
+
+	items.push_back(pool.request(std::uint64_t{ 17U }));
+	items.push_back(pool.request(std::uint64_t{ 18U }));
+
+	REQUIRE(pool.committedCapacity() == CAPACITY);
+	REQUIRE(pool.isFull());
+	REQUIRE_THROWS_AS(pool.request(std::uint64_t{ 0U }), sop::max_capacity_exception);
+	REQUIRE(items[GRANULE_SLOTS].get() != items[GRANULE_SLOTS + 1U].get());
+	REQUIRE(*items[GRANULE_SLOTS] + *items[GRANULE_SLOTS + 1U] == 35U);
+	REQUIRE(*items[GRANULE_SLOTS - 1U] == GRANULE_SLOTS - 1U);
+
+	items.clear();
+	REQUIRE(pool.size() == 0U);
+}
+
+TEST_CASE("full pools overflow to the heap", "[StackfullObjectPool][Overflow]")
+{
+	STATIC_REQUIRE(!sop::StackfullObjectPool<int, 8U>::OVERFLOWS);
+	STATIC_REQUIRE(sop::StackfullObjectPool<int, 8U, sop::HeapOverflowPoolTraits>::OVERFLOWS);
+
+	sop::StackfullObjectPool<TrivialSturct, 2U, sop::HeapOverflowPoolTraits> pool{};
+	std::vector<sop::PoolItem<TrivialSturct, 2U, sop::HeapOverflowPoolTraits>> items{};
+
+	for (int i{ 0 }; i != 5; ++i)
+	{
+		items.push_back(pool.request(i, 0.5f, 0.25));
+	}
+
+	REQUIRE(pool.isFull());
+	REQUIRE(pool.size() == 2U);
+	REQUIRE(pool.overflowCount() == 3U);
+
+	for (int i{ 0 }; i != 5; ++i)
+	{
+		REQUIRE(items[static_cast<std::size_t>(i)]->i == i);
+	}
+
+	// overflow objects go back to the heap, pooled ones to their slots
+	TrivialSturct* const pooled{ items[1U].get() };
+	items.pop_back();
+	items.pop_back();
+	items.pop_back();
+	REQUIRE(pool.size() == 2U);
+
+	items.pop_back();
+	REQUIRE(pool.size() == 1U);
+
+	auto trivial = pool.request(-1, 0.0f, 0.0);
+	REQUIRE(trivial.get() == pooled);
+	REQUIRE(pool.overflowCount() == 3U);
+}
+
+TEST_CASE("full pools overflow to a user allocator", "[StackfullObjectPool][Overflow]")
+{
+	sop::StackfullObjectPool<std::uint64_t, 4U, CountingOverflowTraits> pool{};
+
+	{
+		std::vector<sop::PoolItem<std::uint64_t, 4U, CountingOverflowTraits>> items{};
+
+		for (std::uint64_t i{ 0U }; i != 10U; ++i)
+		{
+			items.push_back(pool.request(i));
+		}
+
+		REQUIRE(CountingAllocator<std::uint64_t>::live == 6);
+		REQUIRE(pool.overflowCount() == 6U);
+		REQUIRE(*items[9U] == 9U);
+	}
+
+	REQUIRE(CountingAllocator<std::uint64_t>::live == 0);
+	REQUIRE(pool.size() == 0U);
+}
+
+TEMPLATE_TEST_CASE("tryRequest reports exhaustion without throwing", "[StackfullObjectPool][ErrorPolicy]", sop::DefaultPoolTraits, sop::LockFreePoolTraits, sop::MagazinePoolTraits, sop::HierarchicalBitmapPoolTraits)
+{
+	sop::StackfullObjectPool<TrivialSturct, 2U, TestType> pool{};
+
+	auto pTrivial1 = pool.tryRequest(1, 1.0f, 1.0);
+	auto pTrivial2 = pool.tryRequest(2, 2.0f, 2.0);
+
+	REQUIRE(pTrivial1.has_value());
+	REQUIRE(pTrivial2.has_value());
+	REQUIRE((*pTrivial2)->i == 2);
+	REQUIRE(pool.isFull());
+
+	auto pTrivial3 = pool.tryRequest(3, 3.0f, 3.0);
+	REQUIRE(!pTrivial3.has_value());
+
+	pTrivial1.reset();
+	REQUIRE(pool.size() == 1U);
+
+	auto pTrivial4 = pool.tryRequest(4, 4.0f, 4.0);
+	REQUIRE(pTrivial4.has_value());
+	REQUIRE((*pTrivial4)->d == 4.0);
+}
+
+TEST_CASE("tryRequest on every pool kind", "[ShardedObjectPool][DynamicObjectPool][ChunkedObjectPool][ReservedObjectPool][ErrorPolicy]")
+{
+	sop::ShardedObjectPool<int, 4U, 2U> shardedPool{};
+	std::vector<sop::ShardedPoolItem<int, 4U, 2U>> shardedItems{};
+
+	for (int i{ 0 }; i != 4; ++i)
+	{
+		shardedItems.push_back(std::move(*shardedPool.tryRequest(i)));
+	}
+
+	REQUIRE(!shardedPool.tryRequest(4).has_value());
+
+	sop::DynamicObjectPool<int> dynamicPool{ 1U };
+	auto dynamicItem = dynamicPool.tryRequest(1);
+
+	REQUIRE(dynamicItem.has_value());
+	REQUIRE(!dynamicPool.tryRequest(2).has_value());
+
+	sop::ChunkedObjectPool<std::uint64_t, 4U> chunkedPool{ 2U };
+	std::vector<sop::ChunkedPoolItem<std::uint64_t, 4U>> chunkedItems{};
+
+	for (std::uint64_t i{ 0U }; i != 8U; ++i)
+	{
+		chunkedItems.push_back(std::move(*chunkedPool.tryRequest(i)));
+	}
+
+	REQUIRE(!chunkedPool.tryRequest(std::uint64_t{ 8U }).has_value());
+	REQUIRE(*chunkedItems.back() == 7U);
+
+	// full pools which overflow never come up empty
+	sop::StackfullObjectPool<int, 1U, sop::HeapOverflowPoolTraits> overflowPool{};
+	auto pooled = overflowPool.tryRequest(1);
+	auto overflowed = overflowPool.tryRequest(2);
+
+	REQUIRE(overflowed.has_value());
+	REQUIRE(overflowPool.overflowCount() == 1U);
+
+	sop::ReservedObjectPool<int, 2U> reservedPool{};
+	auto reservedItem1 = reservedPool.tryRequest(1);
+	auto reservedItem2 = reservedPool.tryRequest(2);
+
+	REQUIRE(reservedItem2.has_value());
+	REQUIRE(!reservedPool.tryRequest(3).has_value());
+}
+
+TEST_CASE("error policy chosen through the traits", "[StackfullObjectPool][DynamicObjectPool][ErrorPolicy]")
+{
+	STATIC_REQUIRE(std::is_same_v<sop::DefaultPoolTraits::ErrorPolicy, sop::ThrowOnError>);
+
+	CustomErrorPolicy::failures = 0;
+
+	sop::StackfullObjectPool<int, 1U, CustomErrorTraits> pool{};
+	auto item = pool.request(1);
+
+	REQUIRE_THROWS_AS(pool.request(2), pool_exhausted);
+	REQUIRE(!pool.tryRequest(2).has_value());
+	REQUIRE(CustomErrorPolicy::failures == 1);
+
+	sop::DynamicObjectPool<int, CustomErrorTraits> dynamicPool{ 1U };
+	auto dynamicItem = dynamicPool.request(1);
+
+	REQUIRE_THROWS_AS(dynamicPool.request(1), pool_exhausted);
+	REQUIRE(CustomErrorPolicy::failures == 2);
+}
+
+TEST_CASE("blocking request waits for a release", "[StackfullObjectPool][Blocking]")
+{
+	using namespace std::chrono_literals;
+
+	STATIC_REQUIRE(!sop::StackfullObjectPool<int, 8U>::BLOCKS);
+	STATIC_REQUIRE(sop::StackfullObjectPool<int, 8U, sop::BlockingPoolTraits>::BLOCKS);
+
+	sop::StackfullObjectPool<TrivialSturct, 2U, sop::BlockingPoolTraits> pool{};
+
+	auto pTrivial1 = pool.requestFor(0ms, 1, 1.0f, 1.0);
+	auto pTrivial2 = pool.requestFor(0ms, 2, 2.0f, 2.0);
+	REQUIRE(pool.isFull());
+
+	const auto start = std::chrono::steady_clock::now();
+	auto timedOut = pool.requestFor(20ms, 3, 3.0f, 3.0);
+
+	REQUIRE(!timedOut.has_value());
+	REQUIRE(std::chrono::steady_clock::now() - start >= 20ms);
+
+	TrivialSturct* const freed{ pTrivial1->get() };
+	std::jthread releaser{ [&pTrivial1]()
+		{
+			std::this_thread::sleep_for(20ms);
+			pTrivial1.reset();
+		} };
+
+	auto pTrivial3 = pool.requestUntil(std::chrono::steady_clock::now() + 10s, 3, 3.0f, 3.0);
+
+	REQUIRE(pTrivial3.has_value());
+	REQUIRE(pTrivial3->get() == freed);
+	REQUIRE((*pTrivial3)->d == 3.0);
+}
+
+TEST_CASE("blocking requests under concurrent load", "[StackfullObjectPool][Blocking]")
+{
+	using namespace std::chrono_literals;
+
+	struct LockFreeBlockingTraits : sop::LockFreePoolTraits
+	{
+		using WaitQueue = sop::ConditionWaitQueue;
+	};
+
+	constexpr std::size_t THREADS{ 8U };
+	constexpr std::size_t ITERATIONS{ 2'000U };
+
+	sop::StackfullObjectPool<std::uint64_t, 3U, LockFreeBlockingTraits> pool{};
+	std::atomic<std::size_t> timeouts{ 0U };
+	std::atomic<bool> corrupted{ false };
+
+	{
+		std::vector<std::jthread> threads{};
+
+		for (std::size_t t{ 0U }; t != THREADS; ++t)
+		{
+			threads.emplace_back([&pool, &timeouts, &corrupted, t]()
+				{
+					for (std::size_t i{ 0U }; i != ITERATIONS; ++i)
+					{
+						// a lost wakeup would leave a request parked until its deadline although slots are open
+						auto item = pool.requestFor(10s, std::uint64_t{ t * ITERATIONS + i });
+
+						if (!item.has_value())
+						{
+							timeouts.fetch_add(1U, std::memory_order_relaxed);
+							continue;
+						}
+
+						std::this_thread::yield();
+						corrupted.store(corrupted.load(std::memory_order_relaxed) || **item != t * ITERATIONS + i, std::memory_order_relaxed);
+					}
+				});
+		}
+	}
+
+	REQUIRE(timeouts.load() == 0U);
+	REQUIRE(!corrupted.load());
+	REQUIRE(pool.size() == 0U);
+}
+
+TEST_CASE("coroutines await slots of a full pool", "[StackfullObjectPool][Async]")
+{
+	STATIC_REQUIRE(!sop::StackfullObjectPool<int, 8U>::AWAITS);
+	STATIC_REQUIRE(AsyncPool::AWAITS);
+
+	AsyncPool pool{};
+	LocalScheduler scheduler{};
+	std::deque<sop::PoolItem<TrivialSturct, 2U, sop::AsyncPoolTraits>> held{};
+
+	// an open slot is handed out without suspending
+	holdSlot(pool, scheduler, 1, held);
+	holdSlot(pool, scheduler, 2, held);
+	REQUIRE(held.size() == 2U);
+	REQUIRE(scheduler.ready.empty());
+
+	holdSlot(pool, scheduler, 3, held);
+	holdSlot(pool, scheduler, 4, held);
+	REQUIRE(held.size() == 2U);
+	REQUIRE(pool.isFull());
+
+	// the freed slot goes to the coroutine which parked first, and is only taken once the scheduler resumes it
+	TrivialSturct* const freed{ held.back().get() };
+	held.pop_back();
+
+	REQUIRE(scheduler.ready.size() == 1U);
+	REQUIRE(pool.isFull());
+	REQUIRE(!pool.tryRequest(5, 0.5f, 0.25).has_value());
+
+	scheduler.run();
+	REQUIRE(held.size() == 2U);
+	REQUIRE(held.back()->i == 3);
+	REQUIRE(held.back().get() == freed);
+
+	held.pop_front();
+	scheduler.run();
+	REQUIRE(held.back()->i == 4);
+
+	held.clear();
+	REQUIRE(pool.size() == 0U);
+}
+
+TEST_CASE("destroying a parked coroutine", "[StackfullObjectPool][Async]")
+{
+	struct ThrowingExecutor
+	{
+		void operator()(std::coroutine_handle<>) { }
+	};
+
+	// the executor runs inside release(), which mustn't throw
+	STATIC_REQUIRE(sop::CoroutineExecutor<LocalScheduler>);
+	STATIC_REQUIRE(!sop::CoroutineExecutor<ThrowingExecutor>);
+
+	AsyncPool pool{};
+	LocalScheduler scheduler{};
+	std::deque<sop::PoolItem<TrivialSturct, 2U, sop::AsyncPoolTraits>> held{};
+
+	holdSlot(pool, scheduler, 1, held);
+	holdSlot(pool, scheduler, 2, held);
+
+	// destroyed while parked, it leaves the queue and the released slot goes back to the pool
+	OwnedTask parked{ holdOwnedSlot(pool, scheduler, 3, held) };
+	parked.handle.destroy();
+
+	held.pop_back();
+	REQUIRE(scheduler.ready.empty());
+	REQUIRE(pool.size() == 1U);
+
+	holdSlot(pool, scheduler, 2, held);
+	REQUIRE(pool.isFull());
+
+	// destroyed after a release handed it a slot but before its executor resumed it, the slot goes back too
+	OwnedTask served{ holdOwnedSlot(pool, scheduler, 3, held) };
+	held.pop_back();
+	REQUIRE(scheduler.ready.size() == 1U);
+	REQUIRE(pool.isFull());
+
+	scheduler.ready.clear();
+	served.handle.destroy();
+	REQUIRE(pool.size() == 1U);
+
+	held.clear();
+	REQUIRE(pool.size() == 0U);
+}
+
+TEST_CASE("coroutines hand slots on in the order they parked", "[StackfullObjectPool][Async]")
+{
+	AsyncPool pool{};
+	LocalScheduler scheduler{};
+	std::vector<int> finished{};
+
+	for (int id{ 0 }; id != 64; ++id)
+	{
+		useSlotBriefly(pool, scheduler, id, finished);
+	}
+
+	REQUIRE(pool.isFull());
+
+	scheduler.run();
+
+	std::vector<int> expected(64U);
+	std::iota(expected.begin(), expected.end(), 0);
+
+	REQUIRE(finished == expected);
+	REQUIRE(pool.size() == 0U);
+}
+
+TEMPLATE_TEST_CASE("batched request and release", "[StackfullObjectPool][Batch]", sop::DefaultPoolTraits, sop::LockedPoolTraits, sop::LockFreePoolTraits, sop::IntrusivePoolTraits, sop::MagazinePoolTraits, sop::HierarchicalBitmapPoolTraits)
+{
+	sop::StackfullObjectPool<TrivialSturct, 8U, TestType> pool{};
+	sop::PoolBatch<TrivialSturct, 8U, TestType> batch{ pool };
+
+	REQUIRE(pool.requestN(5U, batch, sop::BatchMode::ALL_OR_NOTHING, 1, 0.5f, 0.25) == 5U);
+	REQUIRE(batch.size() == 5U);
+	REQUIRE(pool.size() == 5U);
+	REQUIRE(batch[4U].d == 0.25);
+
+	// only 3 open slots left
+	REQUIRE(pool.requestN(4U, batch, sop::BatchMode::ALL_OR_NOTHING, 2, 0.5f, 0.25) == 0U);
+	REQUIRE(batch.size() == 5U);
+	REQUIRE(pool.size() == 5U);
+
+	REQUIRE(pool.requestN(4U, batch, sop::BatchMode::AS_MANY_AS_OPEN, 3, 0.5f, 0.25) == 3U);
+	REQUIRE(batch.size() == 8U);
+	REQUIRE(pool.isFull());
+	REQUIRE(batch[7U].i == 3);
+
+	std::vector<TrivialSturct*> distinct{ batch.begin(), batch.end() };
+	std::sort(distinct.begin(), distinct.end());
+	REQUIRE(std::adjacent_find(distinct.begin(), distinct.end()) == distinct.end());
+
+	batch.clear();
+	REQUIRE(batch.empty());
+	REQUIRE(pool.size() == 0U);
+
+	{
+		sop::PoolBatch<TrivialSturct, 8U, TestType> scoped{ pool };
+		REQUIRE(pool.requestN(8U, scoped, sop::BatchMode::ALL_OR_NOTHING, 4, 0.5f, 0.25) == 8U);
+
+		auto single = pool.tryRequest(5, 0.5f, 0.25);
+		REQUIRE(!single.has_value());
+	}
+
+	REQUIRE(pool.size() == 0U);
+}
+
+TEST_CASE("batched request with a throwing constructor", "[StackfullObjectPool][Batch]")
+{
+	struct ThrowsOnThird
+	{
+		int value;
+
+		explicit ThrowsOnThird(int* constructed)
+			: value{ ++*constructed }
+		{
+			if (value == 3)
+			{
+				throw std::runtime_error{ "third construction" };
+			}
+		}
+	};
+
+	sop::StackfullObjectPool<ThrowsOnThird, 8U> pool{};
+	sop::PoolBatch<ThrowsOnThird, 8U> batch{ pool };
+	int constructed{ 0 };
+
+	// the two objects built before the throw stay in batch, the other four slots go back to the pool
+	REQUIRE_THROWS_AS(pool.requestN(6U, batch, sop::BatchMode::ALL_OR_NOTHING, &constructed), std::runtime_error);
+	REQUIRE(batch.size() == 2U);
+	REQUIRE(pool.size() == 2U);
+	REQUIRE(batch[1U].value == 2);
+
+	REQUIRE(pool.requestN(6U, batch, sop::BatchMode::ALL_OR_NOTHING, &constructed) == 6U);
+	REQUIRE(pool.isFull());
+
+	batch.clear();
+	REQUIRE(pool.size() == 0U);
+}
+
+TEST_CASE("batches under concurrent load", "[StackfullObjectPool][Batch][LockFree]")
+{
+	constexpr std::size_t THREADS{ 4U };
+	constexpr std::size_t ITERATIONS{ 2'000U };
+
+	sop::StackfullObjectPool<std::uint64_t, 64U, sop::LockFreePoolTraits> pool{};
+	std::atomic<bool> corrupted{ false };
+
+	{
+		std::vector<std::jthread> threads{};
+
+		for (std::size_t t{ 0U }; t != THREADS; ++t)
+		{
+			threads.emplace_back([&pool, &corrupted, t]()
+				{
+					sop::PoolBatch<std::uint64_t, 64U, sop::LockFreePoolTraits> batch{ pool };
+
+					for (std::size_t i{ 0U }; i != ITERATIONS; ++i)
+					{
+						const std::size_t count{ pool.requestN(1U + (i + t) % 16U, batch, sop::BatchMode::AS_MANY_AS_OPEN, std::uint64_t{ t }) };
+						std::this_thread::yield();
+
+						bool intact{ count == batch.size() };
+
+						for (std::uint64_t* const obj : batch)
+						{
+							intact = intact && *obj == t;
+						}
+
+						corrupted.store(corrupted.load(std::memory_order_relaxed) || !intact, std::memory_order_relaxed);
+						batch.clear();
+					}
+				});
+		}
+	}
+
+	REQUIRE(!corrupted.load());
+	REQUIRE(pool.size() == 0U);
+}
+
+TEST_CASE("batched releases wake parked requests", "[StackfullObjectPool][Batch][Blocking][Async]")
+{
+	using namespace std::chrono_literals;
+
+	AsyncPool asyncPool{};
+	LocalScheduler scheduler{};
+	std::deque<sop::PoolItem<TrivialSturct, 2U, sop::AsyncPoolTraits>> held{};
+
+	{
+		sop::PoolBatch<TrivialSturct, 2U, sop::AsyncPoolTraits> batch{ asyncPool };
+		REQUIRE(asyncPool.requestN(2U, batch, sop::BatchMode::ALL_OR_NOTHING, 0, 0.5f, 0.25) == 2U);
+
+		holdSlot(asyncPool, scheduler, 1, held);
+		holdSlot(asyncPool, scheduler, 2, held);
+		REQUIRE(held.empty());
+	}
+
+	scheduler.run();
+	REQUIRE(held.size() == 2U);
+	REQUIRE(held.back()->i == 2);
+
+	sop::StackfullObjectPool<int, 4U, sop::BlockingPoolTraits> blockingPool{};
+	std::optional<sop::PoolBatch<int, 4U, sop::BlockingPoolTraits>> batch{ std::in_place, blockingPool };
+	REQUIRE(blockingPool.requestN(4U, *batch, sop::BatchMode::ALL_OR_NOTHING, 0) == 4U);
+
+	std::atomic<std::size_t> served{ 0U };
+	std::vector<std::jthread> waiters{};
+
+	for (int i{ 0 }; i != 3; ++i)
+	{
+		waiters.emplace_back([&blockingPool, &served]()
+			{
+				auto item = blockingPool.requestFor(10s, 1);
+
+				served.fetch_add(item.has_value() ? 1U : 0U);
+
+				// keep the slot until every waiter was served
+				while (served.load() != 3U)
+				{
+					std::this_thread::yield();
+				}
+			});
+	}
+
+	std::this_thread::sleep_for(20ms);
+	batch.reset();
+	waiters.clear();
+
+	REQUIRE(served.load() == 3U);
+}
+
+TEST_CASE("default-initialized requests leave the slot's bytes alone", "[StackfullObjectPool][ShardedObjectPool][DynamicObjectPool][ChunkedObjectPool][DefaultInit]")
+{
+	struct Frame
+	{
+		std::array<std::uint8_t, 4096U> bytes;
+	};
+
+	sop::StackfullObjectPool<Frame, 1U, sop::HeapPoolTraits> pool{};
+
+	Frame* slot;
+
+	{
+		auto frame = pool.request();
+		REQUIRE(std::all_of(frame->bytes.begin(), frame->bytes.end(), [](std::uint8_t byte) { return byte == 0U; }));
+
+		frame->bytes.fill(0xAB);
+		slot = frame.get();
+	}
+
+	{
+		// the frame is about to be overwritten anyway, so it isn't zeroed first
+		auto frame = pool.request(sop::DEFAULT_INIT);
+		REQUIRE(frame.get() == slot);
+		REQUIRE(std::all_of(frame->bytes.begin(), frame->bytes.end(), [](std::uint8_t byte) { return byte == 0xAB; }));
+	}
+
+	{
+		auto frame = pool.request();
+		REQUIRE(frame->bytes[17U] == 0U);
+	}
+
+	// every other request and pool takes the tag too
+	REQUIRE(pool.tryRequest(sop::DEFAULT_INIT).has_value());
+
+	sop::PoolBatch<Frame, 1U, sop::HeapPoolTraits> batch{ pool };
+	REQUIRE(pool.requestN(1U, batch, sop::BatchMode::ALL_OR_NOTHING, sop::DEFAULT_INIT) == 1U);
+	batch.clear();
+
+	sop::ShardedObjectPool<std::uint64_t, 4U, 2U> shardedPool{};
+	sop::DynamicObjectPool<std::uint64_t> dynamicPool{ 4U };
+	sop::ChunkedObjectPool<std::uint64_t, 4U> chunkedPool{ 1U };
+	sop::ReservedObjectPool<std::uint64_t, 4U> reservedPool{};
+
+	*shardedPool.request(sop::DEFAULT_INIT) = 1U;
+	*dynamicPool.request(sop::DEFAULT_INIT) = 2U;
+	*chunkedPool.request(sop::DEFAULT_INIT) = 3U;
+	*reservedPool.request(sop::DEFAULT_INIT) = 4U;
+
+	REQUIRE(shardedPool.size() == 0U);
+	REQUIRE(reservedPool.size() == 0U);
+}
+
+TEST_CASE("compact items are a single pointer wide", "[StackfullObjectPool][Compact]")
+{
+	using Pool = sop::StackfullObjectPool<TrivialSturct, 100U, sop::CompactPoolTraits>;
+
+	STATIC_REQUIRE(sizeof(sop::CompactPoolItem<TrivialSturct, 100U, sop::CompactPoolTraits>) == sizeof(void*));
+	STATIC_REQUIRE(sizeof(sop::PoolItem<TrivialSturct, 100U, sop::CompactPoolTraits>) == 2U * sizeof(void*));
+	STATIC_REQUIRE(std::is_nothrow_default_constructible_v<sop::CompactPoolItem<TrivialSturct, 100U, sop::CompactPoolTraits>>);
+
+	// two pools, so every object has to find its own
+	Pool pool1{};
+	Pool pool2{};
+	std::vector<sop::CompactPoolItem<TrivialSturct, 100U, sop::CompactPoolTraits>> items{};
+
+	for (int i{ 0 }; i != 100; ++i)
+	{
+		items.push_back(pool1.requestCompact(i, 1.0f, 1.0));
+		items.push_back(pool2.requestCompact(-i, 2.0f, 2.0));
+	}
+
+	REQUIRE(pool1.isFull());
+	REQUIRE(pool2.isFull());
+	REQUIRE(items[198U]->i == 99);
+	REQUIRE_THROWS_AS(pool1.requestCompact(), sop::max_capacity_exception);
+
+	// regular items of the same pool still work alongside
+	items.pop_back();
+	auto regular = pool2.request(7, 0.0f, 0.0);
+	REQUIRE(pool2.isFull());
+	regular.reset();
+
+	items.erase(items.begin(), items.begin() + 50);
+	REQUIRE(pool1.size() == 75U);
+	REQUIRE(pool2.size() == 74U);
+
+	items.clear();
+	REQUIRE(pool1.size() == 0U);
+	REQUIRE(pool2.size() == 0U);
+
+	sop::StackfullObjectPool<std::uint64_t, 4U, CompactLockFreeTraits> lockFreePool{};
+	sop::CompactPoolItem<std::uint64_t, 4U, CompactLockFreeTraits> item{};
+	REQUIRE(item == nullptr);
+
+	item = lockFreePool.requestCompact(std::uint64_t{ 42U });
+	REQUIRE(*item == 42U);
+	REQUIRE(lockFreePool.size() == 1U);
+
+	item.reset();
+	REQUIRE(lockFreePool.size() == 0U);
+}
+
+TEST_CASE("live objects are visited in address order", "[StackfullObjectPool][LiveObjects]")
+{
+	constexpr std::size_t CAPACITY{ 200U };
+
+	sop::StackfullObjectPool<int, CAPACITY, sop::LivePoolTraits> pool{};
+	std::vector<sop::PoolItem<int, CAPACITY, sop::LivePoolTraits>> items{};
+
+	pool.forEachLive([](int&) { FAIL("no object is live"); });
+
+	for (int i{ 0 }; i != static_cast<int>(CAPACITY); ++i)
+	{
+		items.push_back(pool.request(i));
+	}
+
+	// release every third object
+	for (std::size_t i{ 0U }; i < items.size(); i += 3U)
+	{
+		items[i].reset();
+	}
+
+	std::vector<int*> visited{};
+	pool.forEachLive([&](int& obj) { visited.push_back(&obj); });
+
+	REQUIRE(visited.size() == pool.size());
+	REQUIRE(std::is_sorted(visited.begin(), visited.end()));
+
+	for (const int* const obj : visited)
+	{
+		REQUIRE(*obj % 3 != 0);
+	}
+
+	// batches, their release included, are tracked as well
+	sop::PoolBatch<int, CAPACITY, sop::LivePoolTraits> batch{ pool };
+	REQUIRE(pool.requestN(10U, batch, sop::BatchMode::ALL_OR_NOTHING, -1) == 10U);
+
+	std::size_t batched{ 0U };
+	pool.forEachLive([&](const int& obj) { batched += obj == -1 ? 1U : 0U; });
+	REQUIRE(batched == 10U);
+
+	batch.clear();
+	batched = 0U;
+	pool.forEachLive([&](const int& obj) { batched += obj == -1 ? 1U : 0U; });
+	REQUIRE(batched == 0U);
+
+	// the parts cover every live object exactly once, however many there are
+	for (const std::size_t parts : { 1U, 2U, 3U, 4U, 7U })
+	{
+		std::size_t count{ 0U };
+
+		for (std::size_t part{ 0U }; part != parts; ++part)
+		{
+			pool.forEachLive(part, parts, [&](int&) { ++count; });
+		}
+
+		REQUIRE(count == pool.size());
+	}
+
+	REQUIRE_THROWS_AS(pool.forEachLive(0U, 0U, [](int&) { }), std::out_of_range);
+	REQUIRE_THROWS_AS(pool.forEachLive(4U, 4U, [](int&) { }), std::out_of_range);
+
+	// a thread per task is enough for a test, a real executor keeps its workers between calls
+	const auto threadPerTask = [](std::size_t count, const auto& task)
+		{
+			std::vector<std::jthread> threads{};
+			for (std::size_t i{ 1U }; i < count; ++i)
+			{
+				threads.emplace_back([&task, i]() { task(i); });
+			}
+			task(0U);
+		};
+	STATIC_REQUIRE(sop::BulkExecutor<decltype(threadPerTask)>);
+
+	std::atomic<std::size_t> count{ 0U };
+	pool.forEachLiveParallel(threadPerTask, 4U, [&](int& obj) {
+		++obj;
+		count.fetch_add(1U, std::memory_order_relaxed);
+	});
+	REQUIRE(count.load() == pool.size());
+
+	for (std::size_t i{ 1U }; i < items.size(); i += 3U)
+	{
+		REQUIRE(*items[i] == static_cast<int>(i) + 1);
+	}
+
+	// the smallest executor the concept admits isn't a template, it takes the type-erased task
+	struct InlineExecutor
+	{
+		std::size_t calls{ 0U };
+
+		void operator()(std::size_t count, const sop::BulkTask& task)
+		{
+			for (std::size_t i{ 0U }; i != count; ++i)
+			{
+				task(i);
+				++calls;
+			}
+		}
+	};
+	STATIC_REQUIRE(sop::BulkExecutor<InlineExecutor>);
+	STATIC_REQUIRE_FALSE(sop::BulkExecutor<void (*)(std::size_t, void (*)(std::size_t))>);
+
+	InlineExecutor inlineExecutor{};
+	pool.forEachLiveParallel(inlineExecutor, 3U, [](int& obj) { --obj; });
+	REQUIRE(inlineExecutor.calls == 3U);
+
+	for (std::size_t i{ 1U }; i < items.size(); i += 3U)
+	{
+		REQUIRE(*items[i] == static_cast<int>(i));
+	}
+
+	// objects from the OverflowAllocator aren't in the slots, so they aren't visited
+	sop::StackfullObjectPool<int, 2U, LiveOverflowTraits> overflowPool{};
+	auto first = overflowPool.request(1);
+	auto second = overflowPool.request(2);
+	auto overflown = overflowPool.request(3);
+
+	int sum{ 0 };
+	overflowPool.forEachLive([&](int& obj) { sum += obj; });
+	REQUIRE(sum == 3);
+
+	first.reset();
+	sum = 0;
+	overflowPool.forEachLive([&](int& obj) { sum += obj; });
+	REQUIRE(sum == 2);
+}
+
+TEST_CASE("soa pool keeps every field in a column of its own", "[SoaObjectPool]")
+{
+	constexpr std::size_t CAPACITY{ 200U };
+
+	using Pool = sop::SoaObjectPool<std::tuple<int, float, double>, CAPACITY>;
+
+	Pool pool{};
+	std::vector<Pool::Item> items{};
+
+	REQUIRE(pool.capacity() == CAPACITY);
+	REQUIRE(reinterpret_cast<std::uintptr_t>(pool.column<1U>().data()) % sop::CACHE_LINE_SIZE == 0U);
+	REQUIRE(reinterpret_cast<std::uintptr_t>(pool.column<2U>().data()) % sop::CACHE_LINE_SIZE == 0U);
+
+	for (int i{ 0 }; i != static_cast<int>(CAPACITY); ++i)
+	{
+		items.push_back(pool.request(i, static_cast<float>(i), 0.5));
+	}
+
+	REQUIRE(pool.isFull());
+	REQUIRE_THROWS_AS(pool.request(), sop::max_capacity_exception);
+	REQUIRE_FALSE(pool.tryRequest().has_value());
+
+	REQUIRE(items[7U].get<0U>() == 7);
+	REQUIRE(items[7U].get<1U>() == 7.0f);
+	REQUIRE(&items[7U].get<2U>() == &pool.column<2U>()[items[7U].index()]);
+
+	// release slots 50-99 and 150-159, leaving three runs of live slots
+	for (std::size_t i{ 50U }; i != 100U; ++i)
+	{
+		items[i].reset();
+	}
+
+	for (std::size_t i{ 150U }; i != 160U; ++i)
+	{
+		// moving an item out leaves an empty one behind, the slot goes back once the moved-to item is destroyed
+		Pool::Item moved{ std::move(items[i]) };
+		REQUIRE_FALSE(items[i]);
+	}
+
+	REQUIRE(pool.size() == 140U);
+
+	std::vector<std::pair<std::size_t, std::size_t>> runs{};
+	pool.forEachLiveRun([&](std::size_t first, std::size_t last) { runs.emplace_back(first, last); });
+
+	REQUIRE(runs == std::vector<std::pair<std::size_t, std::size_t>>{ { 0U, 50U }, { 100U, 150U }, { 160U, 200U } });
+
+	// a single field kernel over the live runs
+	const std::span<float, CAPACITY> f{ pool.column<1U>() };
+
+	pool.forEachLiveRun([&](std::size_t first, std::size_t last) {
+		for (std::size_t i{ first }; i != last; ++i)
+		{
+			f[i] += 1.0f;
+		}
+	});
+
+	REQUIRE(items[0U].get<1U>() == 1.0f);
+	REQUIRE(items[199U].get<1U>() == 200.0f);
+
+	// and slot by slot
+	std::vector<std::size_t> slots{};
+	pool.forEachLive([&](std::size_t slot) { slots.push_back(slot); });
+	REQUIRE(slots.size() == pool.size());
+	REQUIRE(std::is_sorted(slots.begin(), slots.end()));
+	REQUIRE(slots[50U] == 100U);
+
+	// the parts cover every live slot exactly once, however many there are
+	for (const std::size_t parts : { 1U, 2U, 3U, 4U })
+	{
+		std::size_t count{ 0U };
+
+		for (std::size_t part{ 0U }; part != parts; ++part)
+		{
+			pool.forEachLiveRun(part, parts, [&](std::size_t first, std::size_t last) { count += last - first; });
+		}
+
+		REQUIRE(count == pool.size());
+	}
+
+	REQUIRE_THROWS_AS(pool.forEachLiveRun(0U, 0U, [](std::size_t, std::size_t) { }), std::out_of_range);
+	REQUIRE_THROWS_AS(pool.forEachLiveRun(4U, 4U, [](std::size_t, std::size_t) { }), std::out_of_range);
+
+	// released slots are handed out again, value-initialized unless asked not to
+	Pool::Item zeroed{ pool.request() };
+	REQUIRE(zeroed.get<0U>() == 0);
+	REQUIRE(zeroed.get<1U>() == 0.0f);
+
+	Pool::Item moved{ std::move(zeroed) };
+	REQUIRE_FALSE(zeroed);
+	REQUIRE(moved);
+
+	items.clear();
+	moved.reset();
+	REQUIRE(pool.size() == 0U);
+	pool.forEachLiveRun([](std::size_t, std::size_t) { FAIL("no slot is live"); });
+
+	// an intrusive free list keeps its links in the first column
+	sop::SoaObjectPool<std::tuple<std::uint32_t, double>, 4U, sop::IntrusivePoolTraits> intrusivePool{};
+	auto first = intrusivePool.request(1U, 1.0);
+	auto second = intrusivePool.request(sop::DEFAULT_INIT);
+	first.reset();
+	auto third = intrusivePool.request(3U, 3.0);
+	REQUIRE(third.get<0U>() == 3U);
+	REQUIRE(intrusivePool.size() == 2U);
+}
+
+TEST_CASE("slot map handles go stale once released", "[SlotMap]")
+{
+	using Map = sop::SlotMap<TrivialSturct, 4U>;
+	using Handle = Map::Handle;
+
+	STATIC_REQUIRE(sizeof(Handle) == sizeof(std::uint32_t));
+	STATIC_REQUIRE(sizeof(sop::SlotHandle<1U << 20U>) == sizeof(std::uint64_t));
+	STATIC_REQUIRE(std::is_trivially_copyable_v<Handle>);
+
+	Map map{};
+	REQUIRE(map.capacity() == 4U);
+	REQUIRE(map.get(Handle{}) == nullptr);
+
+	const Handle first{ map.request(1, 1.0f, 1.0) };
+	const Handle second{ map.request(2, 2.0f, 2.0) };
+	REQUIRE(first != second);
+	REQUIRE(map.size() == 2U);
+	REQUIRE(map.get(first)->i == 1);
+	REQUIRE(map.get(second)->i == 2);
+	REQUIRE(map.handleOf(*map.get(second)) == second);
+	REQUIRE(Handle::fromValue(second.value()) == second);
+
+	// the released slot is reused right away, but the old handle doesn't reach the new object
+	REQUIRE(map.release(first));
+	REQUIRE_FALSE(map.release(first));
+	REQUIRE_FALSE(map.contains(first));
+	REQUIRE(map.get(first) == nullptr);
+
+	const Handle reused{ map.request(3, 3.0f, 3.0) };
+	REQUIRE(reused.index() == first.index());
+	REQUIRE(reused.generation() != first.generation());
+	REQUIRE(map.get(first) == nullptr);
+	REQUIRE(map.get(reused)->i == 3);
+
+	// a handle with an index out of range or the generation of a free slot is stale too
+	REQUIRE(map.get(Handle{ 3U, 1U }) == nullptr);
+	REQUIRE(map.get(Handle{ 7U, 1U }) == nullptr);
+
+	REQUIRE(map.request(4, 0.0f, 0.0) != Handle{});
+	REQUIRE(map.request(5, 0.0f, 0.0) != Handle{});
+	REQUIRE(map.isFull());
+	REQUIRE_THROWS_AS(map.request(), sop::max_capacity_exception);
+	REQUIRE_FALSE(map.tryRequest().has_value());
+
+	REQUIRE(map.release(second));
+	REQUIRE(map.tryRequest(6, 0.0f, 0.0).has_value());
+}
+
+TEST_CASE("slot map visits just its live objects", "[SlotMap]")
+{
+	constexpr std::size_t CAPACITY{ 1000U };
+
+	sop::SlotMap<int, CAPACITY, sop::HeapPoolTraits> map{};
+	std::vector<sop::SlotMap<int, CAPACITY, sop::HeapPoolTraits>::Handle> handles{};
+
+	for (int i{ 0 }; i != static_cast<int>(CAPACITY); ++i)
+	{
+		handles.push_back(map.request(i));
+	}
+
+	// release every odd object
+	for (std::size_t i{ 1U }; i < CAPACITY; i += 2U)
+	{
+		REQUIRE(map.release(handles[i]));
+	}
+
+	REQUIRE(map.size() == CAPACITY / 2U);
+
+	std::size_t visited{ 0U };
+	int sum{ 0 };
+
+	map.forEach([&](int& obj) {
+		REQUIRE(obj % 2 == 0);
+		sum += obj;
+		++visited;
+		obj += 1;
+	});
+
+	REQUIRE(visited == CAPACITY / 2U);
+	REQUIRE(sum == 249500);
+
+	const auto& constMap = map;
+
+	constMap.forEach([&](auto handle, const int& obj) {
+		REQUIRE(constMap.get(handle) == &obj);
+		REQUIRE(obj % 2 == 1);
+	});
+
+	// every object handed out again gets a fresh handle, and is visited as well
+	for (std::size_t i{ 1U }; i < CAPACITY; i += 2U)
+	{
+		REQUIRE(map.get(handles[i]) == nullptr);
+		handles[i] = map.request(-1);
+	}
+
+	visited = 0U;
+	map.forEach([&](int&) { ++visited; });
+	REQUIRE(visited == CAPACITY);
+
+	for (const auto handle : handles)
+	{
+		REQUIRE(map.release(handle));
+	}
+
+	REQUIRE(map.size() == 0U);
+	map.forEach([](int&) { FAIL("no object is live"); });
+}
+
+TEST_CASE("sharded pool steals from other shards", "[ShardedObjectPool]")
+{
+	sop::ShardedObjectPool<int, 8U, 4U> intPool{};
+
+	REQUIRE(intPool.capacity() == 8U);
+	REQUIRE(intPool.size() == 0U);
+
+	std::vector<sop::ShardedPoolItem<int, 8U, 4U>> items{};
+
+	// a single thread drains its home shard and then every other shard
+	for (int i{ 0 }; i != 8; ++i)
+	{
+		items.push_back(intPool.request(i));
+		REQUIRE(intPool.size() == static_cast<std::size_t>(i + 1));
+	}
+
+	REQUIRE(intPool.isFull());
+	REQUIRE_THROWS_AS(intPool.request(), sop::max_capacity_exception);
+
+	for (int i{ 0 }; i != 8; ++i)
+	{
+		REQUIRE(*items[static_cast<std::size_t>(i)] == i);
+	}
+
+	items.pop_back();
+	REQUIRE(!intPool.isFull());
+
+	auto pInt = intPool.request(17);
+	REQUIRE(*pInt == 17);
+	REQUIRE(intPool.isFull());
+}
+
+TEST_CASE("sharded pool under concurrent load", "[ShardedObjectPool]")
+{
+	constexpr std::size_t THREADS{ 8U };
+	constexpr std::size_t ITERATIONS{ 20'000U };
+
+	// threads hold up to 16 slots at once, the scan across shards isn't atomic so leave some headroom
+	sop::ShardedObjectPool<std::size_t, 32U, 4U, sop::LockFreePoolTraits> pool{};
+	std::atomic<bool> sharedSlot{ false };
+	std::vector<std::thread> threads{};
+
+	for (std::size_t t{ 0U }; t != THREADS; ++t)
+	{
+		threads.emplace_back([&pool, &sharedSlot, t]()
+			{
+				for (std::size_t i{ 0U }; i != ITERATIONS; ++i)
+				{
+					auto item1 = pool.request(t);
+					auto item2 = pool.request(t);
+
+					std::this_thread::yield();
+
+					if (*item1 != t || *item2 != t)
+					{
+						sharedSlot = true;
+					}
+				}
+			});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE(!sharedSlot);
+	REQUIRE(pool.size() == 0U);
+}
@@ -0,0 +1,271 @@
+﻿#ifndef STACKFULL_OBJECT_POOL_STORAGES
+#define STACKFULL_OBJECT_POOL_STORAGES
+
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "ErrorPolicies.hpp"
+
+#if __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <unistd.h>
+#define SOP_HAS_MMAP
+#endif
+
+
+namespace sop
+{
+    // A storage owns the pool's Slab - its slots together with its free list - and reaches it through operator->.
+    // The Slab is constructed in place from the storage's constructor arguments, and never moves
+    // since the free list may point into the slots.
+
+
+    // The original storage - the Slab is a member of the pool itself.
+    template <typename Slab>
+    class InlineStorage
+    {
+    public:
+        template <typename... Args>
+        explicit InlineStorage(Args&&... args) noexcept(std::is_nothrow_constructible_v<Slab, Args...>);
+
+        [[nodiscard]] Slab* operator->() noexcept;
+
+        [[nodiscard]] const Slab* operator->() const noexcept;
+
+    private:
+        Slab slab_;
+    };
+
+
+    // The Slab lives on the heap, aligned as it requires, so the pool object itself stays a few bytes in size
+    // and large pools may be declared locally.
+    template <typename Slab>
+    class HeapStorage
+    {
+    public:
+        template <typename... Args>
+        explicit HeapStorage(Args&&... args) noexcept(false);
+
+        [[nodiscard]] Slab* operator->() noexcept;
+
+        [[nodiscard]] const Slab* operator->() const noexcept;
+
+    private:
+        const std::unique_ptr<Slab> slab_;
+    };
+
+
+    // The Slab lives on the heap as with HeapStorage, but aligned to its own size rounded up to a power of two,
+    // so every address within it masks down to its start - owner() finds the Slab a pooled object lives in
+    // from the object's address alone, which lets the pool hand out items that don't point back at it.
+    template <typename Slab>
+    class SizeAlignedStorage
+    {
+    public:
+        static constexpr std::size_t ALIGNMENT{ std::bit_ceil(std::max(sizeof(Slab), alignof(Slab))) };
+
+        template <typename... Args>
+        explicit SizeAlignedStorage(Args&&... args) noexcept(false);
+
+        SizeAlignedStorage(const SizeAlignedStorage&) = delete;
+        SizeAlignedStorage& operator=(const SizeAlignedStorage&) = delete;
+
+        ~SizeAlignedStorage();
+
+        [[nodiscard]] Slab* operator->() noexcept;
+
+        [[nodiscard]] const Slab* operator->() const noexcept;
+
+        // the Slab address lies within
+        [[nodiscard]] static Slab* owner(const void* address) noexcept;
+
+    private:
+        Slab* const slab_;
+
+        template <typename... Args>
+        [[nodiscard]] static Slab* allocate(Args&&... args) noexcept(false);
+    };
+
+
+#ifdef SOP_HAS_MMAP
+    // The Slab lives in an anonymous private mapping of its own, page aligned and handed back to the OS
+    // as a whole once the pool is destroyed.
+    template <typename Slab>
+    class MmapStorage
+    {
+    public:
+        template <typename... Args>
+        explicit MmapStorage(Args&&... args) noexcept(false);
+
+        MmapStorage(const MmapStorage&) = delete;
+        MmapStorage& operator=(const MmapStorage&) = delete;
+
+        ~MmapStorage();
+
+        [[nodiscard]] Slab* operator->() noexcept;
+
+        [[nodiscard]] const Slab* operator->() const noexcept;
+
+    private:
+        // the smallest page size around, mmap aligns at least this much
+        static constexpr std::size_t MIN_PAGE_SIZE{ 4096U };
+
+        static_assert(alignof(Slab) <= MIN_PAGE_SIZE, "The slots are aligned beyond a page, use HeapStorage.");
+
+        Slab* const slab_;
+
+        template <typename... Args>
+        [[nodiscard]] static Slab* map(Args&&... args) noexcept(false);
+    };
+#endif
+
+
+    template <typename Slab>
+    template <typename... Args>
+    InlineStorage<Slab>::InlineStorage(Args&&... args) noexcept(std::is_nothrow_constructible_v<Slab, Args...>)
+        : slab_{ std::forward<Args>(args)... }
+    { }
+
+    template <typename Slab>
+    Slab* InlineStorage<Slab>::operator->() noexcept
+    {
+        return &slab_;
+    }
+
+    template <typename Slab>
+    const Slab* InlineStorage<Slab>::operator->() const noexcept
+    {
+        return &slab_;
+    }
+
+
+    template <typename Slab>
+    template <typename... Args>
+    HeapStorage<Slab>::HeapStorage(Args&&... args) noexcept(false)
+        : slab_{ std::make_unique<Slab>(std::forward<Args>(args)...) }
+    { }
+
+    template <typename Slab>
+    Slab* HeapStorage<Slab>::operator->() noexcept
+    {
+        return slab_.get();
+    }
+
+    template <typename Slab>
+    const Slab* HeapStorage<Slab>::operator->() const noexcept
+    {
+        return slab_.get();
+    }
+
+
+    template <typename Slab>
+    template <typename... Args>
+    SizeAlignedStorage<Slab>::SizeAlignedStorage(Args&&... args) noexcept(false)
+        : slab_{ allocate(std::forward<Args>(args)...) }
+    { }
+
+    template <typename Slab>
+    SizeAlignedStorage<Slab>::~SizeAlignedStorage()
+    {
+        slab_->~Slab();
+        ::operator delete(slab_, std::align_val_t{ ALIGNMENT });
+    }
+
+    template <typename Slab>
+    template <typename... Args>
+    Slab* SizeAlignedStorage<Slab>::allocate(Args&&... args) noexcept(false)
+    {
+        return new (::operator new(sizeof(Slab), std::align_val_t{ ALIGNMENT })) Slab{ std::forward<Args>(args)... };
+    }
+
+    template <typename Slab>
+    Slab* SizeAlignedStorage<Slab>::operator->() noexcept
+    {
+        return slab_;
+    }
+
+    template <typename Slab>
+    const Slab* SizeAlignedStorage<Slab>::operator->() const noexcept
+    {
+        return slab_;
+    }
+
+    template <typename Slab>
+    Slab* SizeAlignedStorage<Slab>::owner(const void* address) noexcept
+    {
+        return reinterpret_cast<Slab*>(reinterpret_cast<std::uintptr_t>(address) & ~(ALIGNMENT - 1U));
+    }
+
+
+#ifdef SOP_HAS_MMAP
+    template <typename Slab>
+    template <typename... Args>
+    MmapStorage<Slab>::MmapStorage(Args&&... args) noexcept(false)
+        : slab_{ map(std::forward<Args>(args)...) }
+    { }
+
+    template <typename Slab>
+    MmapStorage<Slab>::~MmapStorage()
+    {
+        slab_->~Slab();
+        ::munmap(slab_, sizeof(Slab));
+    }
+
+    template <typename Slab>
+    template <typename... Args>
+    Slab* MmapStorage<Slab>::map(Args&&... args) noexcept(false)
+    {
+        void* const region{ ::mmap(nullptr, sizeof(Slab), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+
+        if (region == MAP_FAILED) [[unlikely]]
+        {
+            DefaultErrorPolicy::fail<std::bad_alloc>();
+        }
+
+        return new (region) Slab{ std::forward<Args>(args)... };
+    }
+
+    template <typename Slab>
+    Slab* MmapStorage<Slab>::operator->() noexcept
+    {
+        return slab_;
+    }
+
+    template <typename Slab>
+    const Slab* MmapStorage<Slab>::operator->() const noexcept
+    {
+        return slab_;
+    }
+#endif
+
+
+    // Hands the physical memory of the whole pages within [begin, end) back to the OS, where mmap is available.
+    // The range must not be in use, its pages read as zeros when touched again.
+    inline void decommit(std::byte* begin, std::byte* end) noexcept
+    {
+#ifdef SOP_HAS_MMAP
+        static const std::uintptr_t pageSize{ static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE)) };
+
+        const std::uintptr_t first{ (reinterpret_cast<std::uintptr_t>(begin) + pageSize - 1U) & ~(pageSize - 1U) };
+        const std::uintptr_t last{ reinterpret_cast<std::uintptr_t>(end) & ~(pageSize - 1U) };
+
+        if (first < last)
+        {
+            ::madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+        }
+#else
+        static_cast<void>(begin);
+        static_cast<void>(end);
+#endif
+    }
+}
+
+
+#endif // !STACKFULL_OBJECT_POOL_STORAGES
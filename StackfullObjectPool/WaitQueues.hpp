@@ -0,0 +1,278 @@
+﻿#ifndef STACKFULL_OBJECT_POOL_WAIT_QUEUES
+#define STACKFULL_OBJECT_POOL_WAIT_QUEUES
+
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+
+
+namespace sop
+{
+    // A wait queue parks the requests made on a full pool until a release frees a slot.
+    // waitUntil(deadline, tryAcquire) keeps calling tryAcquire until it returns a non-null pointer or deadline passes,
+    // and the pool calls notify(count) after every release, with the number of slots it released.
+    // CoroutineWaitQueue parks coroutines instead of threads, and hands released slots to them.
+
+
+    // Parks requests on a std::condition_variable. Parked requests are counted, so a release
+    // only locks and notifies while one is parked, and otherwise pays a fence and a load.
+    // Only slots released back to the shared free list wake a request - slots cached by
+    // sop::MagazineCache or sop::PerCpuLockedCache aren't seen until they're spilled.
+    class ConditionWaitQueue
+    {
+    public:
+        template <typename Clock, typename Duration, typename TryAcquire>
+        [[nodiscard]] auto waitUntil(const std::chrono::time_point<Clock, Duration>& deadline, TryAcquire&& tryAcquire) noexcept(false);
+
+        void notify(std::size_t released) noexcept;
+
+    private:
+        std::atomic<std::size_t> waiters_{ 0U };
+        std::mutex mutex_;
+        std::condition_variable released_;
+    };
+
+
+    template <typename Clock, typename Duration, typename TryAcquire>
+    auto ConditionWaitQueue::waitUntil(const std::chrono::time_point<Clock, Duration>& deadline, TryAcquire&& tryAcquire) noexcept(false)
+    {
+        waiters_.fetch_add(1U, std::memory_order_relaxed);
+
+        // pairs with the fence in notify() - either this request sees the released slot, or the release sees this request
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        decltype(tryAcquire()) acquired{ nullptr };
+
+        {
+            std::unique_lock lock{ mutex_ };
+
+            released_.wait_until(lock, deadline, [&acquired, &tryAcquire]()
+                {
+                    acquired = tryAcquire();
+
+                    return acquired != nullptr;
+                });
+        }
+
+        waiters_.fetch_sub(1U, std::memory_order_relaxed);
+
+        return acquired;
+    }
+
+    inline void ConditionWaitQueue::notify(std::size_t released) noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (waiters_.load(std::memory_order_relaxed) == 0U) [[likely]]
+        {
+            return;
+        }
+
+        // taking the lock orders this notification after a parked request's last look at the free list
+        {
+            std::lock_guard lock{ mutex_ };
+        }
+
+        if (released == 1U)
+        {
+            released_.notify_one();
+        }
+        else
+        {
+            released_.notify_all();
+        }
+    }
+
+
+    // Resumes the coroutines whose requests were served, e.g. by queueing them on a thread pool or an event loop.
+    // It's called from within release(), which mustn't throw, so it must not throw either,
+    // and should only queue the coroutine so that it resumes outside release().
+    template <typename Executor>
+    concept CoroutineExecutor = std::is_nothrow_invocable_v<Executor&, std::coroutine_handle<>>;
+
+
+    // Parks the coroutines awaiting a slot of a full pool in FIFO order. A release hands its slot straight
+    // to the longest parked coroutine and has it resumed on the coroutine's executor, so parked coroutines
+    // don't compete with later requests for it. As in ConditionWaitQueue, parked coroutines are counted,
+    // so a release only locks while one is parked.
+    class CoroutineWaitQueue
+    {
+    public:
+        // a parked coroutine - it owns slot once it's resumed
+        struct Waiter
+        {
+            Waiter* next;
+            std::byte* slot;
+            // hands the coroutine to its executor
+            void (*resume)(Waiter& waiter) noexcept;
+        };
+
+        // parks waiter unless tryAcquire finds an open slot, which it then leaves in waiter.slot; returns whether it parked
+        template <typename TryAcquire>
+        [[nodiscard]] bool park(Waiter& waiter, TryAcquire&& tryAcquire) noexcept(false);
+
+        // hands slot to the longest parked coroutine instead of releasing it; returns false if none is parked
+        [[nodiscard]] bool handOff(std::byte* slot) noexcept;
+
+        // to be called after every release which didn't hand off its slot,
+        // hands the open slots tryAcquire finds to parked coroutines which raced with the release
+        template <typename TryAcquire>
+        void drain(TryAcquire&& tryAcquire) noexcept;
+
+        // unparks waiter, e.g. as its coroutine is destroyed; returns false if it isn't parked anymore,
+        // in which case a release already handed it a slot
+        [[nodiscard]] bool cancel(Waiter& waiter) noexcept;
+
+    private:
+        std::atomic<std::size_t> parked_{ 0U };
+        std::mutex mutex_;
+        Waiter* head_{ nullptr };
+        Waiter* tail_{ nullptr };
+
+        [[nodiscard]] Waiter* pop() noexcept;
+    };
+
+
+    template <typename TryAcquire>
+    bool CoroutineWaitQueue::park(Waiter& waiter, TryAcquire&& tryAcquire) noexcept(false)
+    {
+        parked_.fetch_add(1U, std::memory_order_relaxed);
+
+        // pairs with the fence in drain() - either this coroutine sees the released slot, or the release sees it parking
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        {
+            std::lock_guard lock{ mutex_ };
+
+            waiter.slot = tryAcquire();
+
+            if (waiter.slot == nullptr)
+            {
+                waiter.next = nullptr;
+                (tail_ != nullptr ? tail_->next : head_) = &waiter;
+                tail_ = &waiter;
+
+                return true;
+            }
+        }
+
+        parked_.fetch_sub(1U, std::memory_order_relaxed);
+
+        return false;
+    }
+
+    inline bool CoroutineWaitQueue::handOff(std::byte* slot) noexcept
+    {
+        if (parked_.load(std::memory_order_relaxed) == 0U) [[likely]]
+        {
+            return false;
+        }
+
+        Waiter* waiter;
+
+        {
+            std::lock_guard lock{ mutex_ };
+
+            waiter = pop();
+
+            if (waiter == nullptr)
+            {
+                return false;
+            }
+
+            waiter->slot = slot;
+        }
+
+        waiter->resume(*waiter);
+
+        return true;
+    }
+
+    template <typename TryAcquire>
+    void CoroutineWaitQueue::drain(TryAcquire&& tryAcquire) noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (parked_.load(std::memory_order_relaxed) == 0U) [[likely]]
+        {
+            return;
+        }
+
+        // the served coroutines are resumed once the lock is dropped, in the order they parked
+        Waiter* served{ nullptr };
+        Waiter** servedTail{ &served };
+
+        {
+            std::lock_guard lock{ mutex_ };
+
+            while (head_ != nullptr)
+            {
+                std::byte* const slot{ tryAcquire() };
+
+                if (slot == nullptr)
+                {
+                    break;
+                }
+
+                Waiter* const waiter{ pop() };
+                waiter->slot = slot;
+                *servedTail = waiter;
+                servedTail = &waiter->next;
+            }
+        }
+
+        *servedTail = nullptr;
+
+        while (served != nullptr)
+        {
+            // resuming may end the coroutine, and with it the waiter
+            Waiter* const next{ served->next };
+            served->resume(*served);
+            served = next;
+        }
+    }
+
+    inline bool CoroutineWaitQueue::cancel(Waiter& waiter) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+
+        Waiter* previous{ nullptr };
+
+        for (Waiter* parked{ head_ }; parked != nullptr; previous = parked, parked = parked->next)
+        {
+            if (parked == &waiter)
+            {
+                (previous != nullptr ? previous->next : head_) = waiter.next;
+                tail_ = tail_ != &waiter ? tail_ : previous;
+                parked_.fetch_sub(1U, std::memory_order_relaxed);
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    inline CoroutineWaitQueue::Waiter* CoroutineWaitQueue::pop() noexcept
+    {
+        Waiter* const waiter{ head_ };
+
+        if (waiter != nullptr)
+        {
+            head_ = waiter->next;
+            tail_ = head_ != nullptr ? tail_ : nullptr;
+            parked_.fetch_sub(1U, std::memory_order_relaxed);
+        }
+
+        return waiter;
+    }
+}
+
+
+#endif // !STACKFULL_OBJECT_POOL_WAIT_QUEUES